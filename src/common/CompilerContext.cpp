@@ -1,26 +1,28 @@
 #include "common/CompilerContext.h"
+#include "common/IncludeReport.h"
+#include "common/Trace.h"
 
+#include <algorithm>
 #include <iostream>
+#include <utility>
 
 #if _WIN32
 #define NOMINMAX
 #include <Windows.h>
 #endif
 
-FeatureSwitch CompilerContext::myWarningSwitches("data/warnings.txt");
+CompilerContext::Options CompilerContext::myOptions;
+bool CompilerContext::myIncludeCacheEnabled = false;
+std::mutex CompilerContext::myIncludeCacheMutex;
+std::unordered_map<std::string, std::optional<std::filesystem::path>> CompilerContext::myIncludeCache;
+std::unordered_map<std::string, std::filesystem::file_time_type> CompilerContext::myLookedInDirectories;
 
-std::vector<std::filesystem::path> CompilerContext::myBaseDirectories;
-std::vector<std::filesystem::path> CompilerContext::myAdditionalDirectories;
+thread_local CompilerContext::State CompilerContext::myThreadState;
+thread_local CompilerContext::State* CompilerContext::myState = &CompilerContext::myThreadState;
+std::atomic<bool> CompilerContext::myHasErrors = false;
+std::mutex CompilerContext::myOutputMutex;
 
-std::vector<std::string> CompilerContext::myPrintContext;
-std::stack<std::vector<std::string>> CompilerContext::myPrintContextStack;
-std::stack<std::filesystem::path> CompilerContext::myFileStack;
-size_t CompilerContext::myIgnoreDepth = 0;
-bool CompilerContext::myHasErrors = false;
-size_t CompilerContext::myCurrentLine = 0;
-std::unordered_map<std::string, std::string> CompilerContext::myFlags;
-
-std::string Escape(std::string aString, size_t& aOutEscapeCount)
+std::string Escape(std::string_view aString, size_t& aOutEscapeCount)
 {
 	std::string out;
 	size_t at = 0;
@@ -60,91 +62,53 @@ std::string Dequote(std::string aString)
 }
 
 
-void CompilerContext::EmitWarning(const std::string& aMessage, const tokenizer::Token& aToken)
-{
-	EmitWarning(aMessage, aToken.myFile, aToken.myColumn, aToken.myLine, aToken.myRawText.length());
-}
-
-void CompilerContext::EmitWarning(const std::string& aMessage,std::filesystem::path aFile, size_t aColumn, size_t aLine, size_t aSize)
-{
-	if (myIgnoreDepth > 0)
-		return;
-
 #if _WIN32
-	std::cout << std::flush;
-	 HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-	 CONSOLE_SCREEN_BUFFER_INFO screenBufferInfo;
-	 if(!GetConsoleScreenBufferInfo(hConsole, &screenBufferInfo))
-		 return;
-	
-	 const WORD backgroundMask = BACKGROUND_BLUE | BACKGROUND_GREEN | BACKGROUND_INTENSITY | BACKGROUND_RED;
-
-	 if(!SetConsoleTextAttribute(hConsole, FOREGROUND_GREEN | FOREGROUND_RED | (screenBufferInfo.wAttributes & backgroundMask)))
-		 return;
-#endif
-
-	std::cout << "WARNING";
-
-#if _WIN32
-	std::cout << std::flush;
-	if(!SetConsoleTextAttribute(hConsole, screenBufferInfo.wAttributes))
-		 return;
-#endif
-
-	std::cout << " " << aMessage <<  " [in file " << aFile.string() << ":" << aLine << ":" ;
-
-	if (aColumn == npos)
-	{
-		std::cout << "eol";
-	}
-	else
+namespace compiler_context_internal
+{
+	// the console is told the colors between the pieces of the text, the label in the color of its severity and the marker in yellow
+	void WriteColored(const Diagnostics::Text& aText, Diagnostic::Severity aSeverity)
 	{
-		std::cout << aColumn;
-	}
+		std::string_view text = aText.myText;
 
-	std::cout << "] " << "\n";
-
-	if (myPrintContext.size() > aLine)
-	{
-		if(aColumn == npos)
-		{
-			std::string line = Escape(myPrintContext[aLine]);
-			std::cout << line << "\n";
-			for(size_t i = 0; i < line.length(); i++)
-			{
-				std::cout << ' ';
-			}
-		}
-		else
+		std::cout << std::flush;
+		HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+		CONSOLE_SCREEN_BUFFER_INFO screenBufferInfo;
+		if (!GetConsoleScreenBufferInfo(console, &screenBufferInfo))
 		{
-			size_t offset = 0;
-			std::cout << Escape(myPrintContext[aLine], offset) << "\n";
-			for (size_t i = 0; i < aColumn + offset; i++)
-			{
-				std::cout << ' ';
-			}
+			std::cout << text;
+			return;
 		}
 
-#if _WIN32
-	std::cout << std::flush;
-	 if(!SetConsoleTextAttribute(hConsole, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY | (screenBufferInfo.wAttributes & backgroundMask)))
-		 return;
-#endif
+		const WORD backgroundMask = BACKGROUND_BLUE | BACKGROUND_GREEN | BACKGROUND_INTENSITY | BACKGROUND_RED;
+		const WORD background = screenBufferInfo.wAttributes & backgroundMask;
+		const WORD label = (aSeverity == Diagnostic::Severity::Error ? FOREGROUND_RED : FOREGROUND_GREEN | FOREGROUND_RED) | background;
+		const WORD marker = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY | background;
 
-		std::cout << '^';
-		for (size_t i = 0; i < aSize - 1; i++)
+		auto write = [&](size_t aBegin, size_t aEnd, WORD aAttributes)
 		{
-			std::cout << '~';
-		}
-
-#if _WIN32
-	std::cout << std::flush;
-	if(!SetConsoleTextAttribute(hConsole, screenBufferInfo.wAttributes))
-		 return;
+			SetConsoleTextAttribute(console, aAttributes);
+			std::cout << text.substr(aBegin, aEnd - aBegin) << std::flush;
+		};
+
+		write(0, aText.myLabelEnd, label);
+		write(aText.myLabelEnd, aText.myMarkerBegin, screenBufferInfo.wAttributes);
+		write(aText.myMarkerBegin, aText.myMarkerEnd, marker);
+		write(aText.myMarkerEnd, text.size(), screenBufferInfo.wAttributes);
+	}
+}
 #endif
 
-		std::cout << "\n\n";
-	}
+void CompilerContext::EmitWarning(const std::string& aMessage, const tokenizer::Token& aToken)
+{
+	EmitWarning(aMessage, aToken.myFile, aToken.myColumn, aToken.myLine, aToken.myRawText.length());
+}
+
+void CompilerContext::EmitWarning(const std::string& aMessage, std::filesystem::path aFile, size_t aColumn, size_t aLine, size_t aSize)
+{
+	if (myState->myIgnoreDepth > 0)
+		return;
+
+	Deliver(MakeDiagnostic(Diagnostic::Severity::Warning, aMessage, std::move(aFile), aColumn, aLine, aSize));
 }
 
 void CompilerContext::EmitError(const std::string& aMessage, const tokenizer::Token& aToken)
@@ -154,113 +118,137 @@ void CompilerContext::EmitError(const std::string& aMessage, const tokenizer::To
 
 void CompilerContext::EmitError(const std::string& aMessage, std::filesystem::path aFile, size_t aColumn, size_t aLine, size_t aSize)
 {
-	if (myIgnoreDepth > 0)
+	if (myState->myIgnoreDepth > 0)
 		return;
 
 	myHasErrors = true;
-	
-#if _WIN32
-	std::cout << std::flush;
-	 HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-	 CONSOLE_SCREEN_BUFFER_INFO screenBufferInfo;
-	 if(!GetConsoleScreenBufferInfo(hConsole, &screenBufferInfo))
-		 return;
-	
-	 const WORD backgroundMask = BACKGROUND_BLUE | BACKGROUND_GREEN | BACKGROUND_INTENSITY | BACKGROUND_RED;
+	myState->myErrorCount++;
 
-	 if(!SetConsoleTextAttribute(hConsole, FOREGROUND_RED | (screenBufferInfo.wAttributes & backgroundMask)))
-		 return;
-#endif
+	Deliver(MakeDiagnostic(Diagnostic::Severity::Error, aMessage, std::move(aFile), aColumn, aLine, aSize));
+}
 
-	std::cerr << "ERROR";
-	
-#if _WIN32
-	std::cout << std::flush;
-	if(!SetConsoleTextAttribute(hConsole, screenBufferInfo.wAttributes))
-		 return;
-#endif
-	std::cout << " " << aMessage << " [in file " << aFile.string() << ":" << aLine << ":";
-	
-	if (aColumn == npos)
+Diagnostic CompilerContext::MakeDiagnostic(Diagnostic::Severity aSeverity, const std::string& aMessage, std::filesystem::path aFile, size_t aColumn, size_t aLine, size_t aSize)
+{
+	Diagnostic diagnostic;
+	diagnostic.mySeverity = aSeverity;
+	diagnostic.myMessage = aMessage;
+	diagnostic.myFile = std::move(aFile);
+	diagnostic.myLine = aLine;
+	diagnostic.myColumn = aColumn == npos ? Diagnostic::EndOfLine : aColumn;
+	diagnostic.mySize = aSize;
+
+	// only the one line quoted is copied, and only once something is wrong
+	if (myState->myPrintContext && myState->myPrintContext->size() > aLine)
+		diagnostic.mySourceLine = (*myState->myPrintContext)[aLine];
+
+	return diagnostic;
+}
+
+void CompilerContext::Deliver(const Diagnostic& aDiagnostic)
+{
+	if (myState->myDiagnostics)
 	{
-		std::cout << "eol";
+		myState->myDiagnostics->push_back(aDiagnostic);
+		return;
 	}
-	else
+
+	if (Diagnostics::IsStructured())
 	{
-		std::cout << aColumn;
+		Diagnostics::Record(aDiagnostic);
+		return;
 	}
 
-	std::cout << "] "  << "\n";
-	if (myPrintContext.size() > aLine)
-	{
-		if (aColumn == npos)
-		{
-			std::string line = Escape(myPrintContext[aLine]);
-			std::cout << line << "\n";
-			for (size_t i = 0; i < line.length(); i++)
-			{
-				std::cout << ' ';
-			}
-		}
-		else
-		{
-			size_t offset = 0;
-			std::cout << Escape(myPrintContext[aLine], offset) << "\n";
-			for (size_t i = 0; i < aColumn + offset; i++)
-			{
-				std::cout << ' ';
-			}
-		}
+	Diagnostics::Text text = Diagnostics::ToText(aDiagnostic);
+
+	std::lock_guard lock(myOutputMutex);
 
 #if _WIN32
-		std::cout << std::flush;
-		 if(!SetConsoleTextAttribute(hConsole, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY | (screenBufferInfo.wAttributes & backgroundMask)))
-			 return;
+	if (!myState->myOutput)
+	{
+		compiler_context_internal::WriteColored(text, aDiagnostic.mySeverity);
+		return;
+	}
 #endif
 
-		std::cout << '^';
-		for (size_t i = 0; i < aSize - 1; i++)
+	Output().write(text.myText.data(), text.myText.size());
+}
+
+std::optional<std::filesystem::path> CompilerContext::FindFile(const std::filesystem::path& aPath, bool aExpandedLookup)
+{
+	std::vector<std::filesystem::path> lookedIn;
+	if (!myIncludeCacheEnabled)
+		return FindFileUncached(aPath, aExpandedLookup, lookedIn);
+
+	// relative to the including file, which can be relative to the working directory
+	std::string key = std::filesystem::current_path().generic_string() + '\n' + myState->myFileStack.top().parent_path().generic_string() + '\n' + aPath.generic_string() + (aExpandedLookup ? "\n<>" : "\n\"\"");
+
+	{
+		std::lock_guard lock(myIncludeCacheMutex);
+		decltype(myIncludeCache)::iterator it = myIncludeCache.find(key);
+		if (it != std::end(myIncludeCache))
 		{
-			std::cout << '~';
+			if (Trace::IsOn(Verbose::Includes))
+				Trace::Line() << "include [" << aPath.generic_string() << "] " << (it->second ? "remembered at " + it->second->generic_string() : "remembered as missing");
+			return it->second;
 		}
+	}
 
-#if _WIN32
-		std::cout << std::flush;
-		if(!SetConsoleTextAttribute(hConsole, screenBufferInfo.wAttributes))
-			 return;
-#endif
+	std::optional<std::filesystem::path> found = FindFileUncached(aPath, aExpandedLookup, lookedIn);
 
-		std::cout << "\n\n";
+	std::lock_guard lock(myIncludeCacheMutex);
+	for (const std::filesystem::path& directory : lookedIn)
+	{
+		std::string directoryKey = std::filesystem::absolute(directory).generic_string();
+		if (myLookedInDirectories.contains(directoryKey))
+			continue;
+
+		std::error_code error;
+		std::filesystem::file_time_type modified = std::filesystem::last_write_time(directory, error);
+		myLookedInDirectories.emplace(std::move(directoryKey), error ? std::filesystem::file_time_type::min() : modified);
 	}
+	myIncludeCache.insert_or_assign(std::move(key), found);
+
+	return found;
 }
 
-std::optional<std::filesystem::path> CompilerContext::FindFile(const std::filesystem::path& aPath, bool aExpandedLookup)
+std::optional<std::filesystem::path> CompilerContext::FindFileUncached(const std::filesystem::path& aPath, bool aExpandedLookup, std::vector<std::filesystem::path>& aOutLookedIn)
 {
+	// a file appearing or disappearing changes the directory it is in, which is not always the one searched when the include has a directory in it
+	auto exists = [&aOutLookedIn, &aPath](const std::filesystem::path& aFullPath)
+	{
+		if (myIncludeCacheEnabled)
+			aOutLookedIn.push_back(aFullPath.has_parent_path() ? aFullPath.parent_path() : ".");
+		bool found = std::filesystem::exists(aFullPath);
+		if (Trace::IsOn(Verbose::Includes))
+			Trace::Line() << "include [" << aPath.generic_string() << "] " << (found ? "found at " : "not at ") << aFullPath.generic_string();
+		return found;
+	};
+
 	if (aExpandedLookup)
 	{
-		for (std::filesystem::path& dir : myBaseDirectories)
+		for (std::filesystem::path& dir : myOptions.myBaseDirectories)
 		{
 			std::filesystem::path fullPath = dir;
 			fullPath /= aPath;
-			if (std::filesystem::exists(fullPath))
+			if (exists(fullPath))
 			{
 				return fullPath;
 			}
 		}
 	}
 
-	std::filesystem::path fullPath = myFileStack.top().parent_path();
+	std::filesystem::path fullPath = myState->myFileStack.top().parent_path();
 	fullPath /= aPath;
-	if (std::filesystem::exists(fullPath))
+	if (exists(fullPath))
 	{
 		return fullPath;
 	}
 
-	for (std::filesystem::path& dir : myAdditionalDirectories)
+	for (std::filesystem::path& dir : myOptions.myAdditionalDirectories)
 	{
 		std::filesystem::path fullPath = dir;
 		fullPath /= aPath;
-		if (std::filesystem::exists(fullPath))
+		if (exists(fullPath))
 		{
 			return fullPath;
 		}
@@ -270,39 +258,63 @@ std::optional<std::filesystem::path> CompilerContext::FindFile(const std::filesy
 	return {};
 }
 
-void CompilerContext::SetPrintContext(const std::vector<std::string>& aPrintContext)
+void CompilerContext::RevalidateIncludeCache()
+{
+	std::lock_guard lock(myIncludeCacheMutex);
+	for (const auto& [directory, modified] : myLookedInDirectories)
+	{
+		std::error_code error;
+		std::filesystem::file_time_type now = std::filesystem::last_write_time(directory, error);
+		if ((error ? std::filesystem::file_time_type::min() : now) != modified)
+		{
+			myIncludeCache.clear();
+			myLookedInDirectories.clear();
+			return;
+		}
+	}
+}
+
+void CompilerContext::SetPrintContext(Source aPrintContext)
 {
-	myPrintContext = aPrintContext;
+	myState->myPrintContext = std::move(aPrintContext);
+}
+
+const std::vector<std::string>& CompilerContext::GetPrintContext()
+{
+	static const std::vector<std::string> none;
+	return myState->myPrintContext ? *myState->myPrintContext : none;
 }
 
 void CompilerContext::SetCurrentLine(size_t aLine)
 {
-	myCurrentLine = aLine;
+	myState->myCurrentLine = aLine;
 }
 
 size_t CompilerContext::GetCurrentLine()
 {
-	return myCurrentLine;
+	return myState->myCurrentLine;
 }
 
 void CompilerContext::PushFile(const std::filesystem::path& aFile)
 {
-	myFileStack.push(aFile);
-	myPrintContextStack.push(myPrintContext);
+	myState->myFileStack.push(aFile);
+	myState->myPrintContextStack.push(myState->myPrintContext);
+	IncludeReport::Enter(aFile);
 }
 
 void CompilerContext::PopFile()
 {
-	myFileStack.pop();
-	SetPrintContext(myPrintContextStack.top());
-	myPrintContextStack.pop();
+	IncludeReport::Leave();
+	myState->myFileStack.pop();
+	SetPrintContext(std::move(myState->myPrintContextStack.top()));
+	myState->myPrintContextStack.pop();
 }
 
 std::filesystem::path CompilerContext::GetCurrentFile()
 {
-	if (myFileStack.empty())
+	if (myState->myFileStack.empty())
 		return "/none";
-	return myFileStack.top();
+	return myState->myFileStack.top();
 }
 
 bool MatchesPattern(std::string aFilePath, std::string aPattern)
@@ -359,6 +371,49 @@ bool MatchesPattern(std::string aFilePath, std::string aPattern)
 
 
 
+namespace compiler_context_internal
+{
+	// Every flag that has a field in CompilerContext::Switches and how its value is read into it
+	struct Switch
+	{
+		std::string_view myFlag;
+		void (*myParse)(CompilerContext::Switches& aSwitches, const std::string& aValue);
+	};
+
+	const std::pair<std::string_view, CompilerContext::Verbose> VerboseCategories[] =
+	{
+		{ "macros",				CompilerContext::Verbose::Macros },
+		{ "precompiler_math",	CompilerContext::Verbose::PrecompilerMath },
+		{ "includes",			CompilerContext::Verbose::Includes },
+		{ "backtracking",		CompilerContext::Verbose::Backtracking }
+	};
+
+	void ParseVerbose(CompilerContext::Switches& aSwitches, const std::string& aValue)
+	{
+		std::string_view left = aValue;
+		while (!left.empty())
+		{
+			std::string_view category = left.substr(0, left.find(','));
+			left.remove_prefix(std::min(left.size(), category.size() + 1));
+
+			auto found = std::ranges::find(VerboseCategories, category, &std::pair<std::string_view, CompilerContext::Verbose>::first);
+			if (found == std::end(VerboseCategories))
+			{
+				CompilerContext::EmitError("Unknown verbose category " + std::string(category) + ", expected macros, precompiler_math, includes or backtracking", "-verbose");
+				continue;
+			}
+			aSwitches.myVerbose |= static_cast<uint32_t>(found->second);
+		}
+	}
+
+	const Switch SwitchTable[] =
+	{
+		{ "verbose",			&ParseVerbose },
+		{ "p:no_whitespace",	[](CompilerContext::Switches& aSwitches, const std::string&) { aSwitches.myNoWhitespace = true; } },
+		{ "p:macro_cache",		[](CompilerContext::Switches& aSwitches, const std::string&) { aSwitches.myMacroCache = true; } }
+	};
+}
+
 std::vector<std::filesystem::path> CompilerContext::ParseCommandLine(int argc, char** argv)
 {
 	std::vector<std::string> potentialFiles;
@@ -375,21 +430,28 @@ std::vector<std::filesystem::path> CompilerContext::ParseCommandLine(int argc, c
 				i++;
 			}
 
+			if (flagName != "dir" && flagName != "file" && flagName != "f")
+				myOptions.myCommandLineFlags.emplace_back(flagName, flagValue);
+
 			if (flagName.starts_with("w:"))
 			{
-				if(flagValue == "disable")
-					myWarningSwitches.Disable(flagName.substr(2));
-				else
-					myWarningSwitches.Enable(flagName.substr(2));
+				std::string_view warning = std::string_view(flagName).substr(2);
+				bool known = flagValue == "disable" ? myOptions.myWarningSwitches.Disable(warning) : myOptions.myWarningSwitches.Enable(warning);
+				if (!known)
+					EmitError("Unknown warning or warning collection " + std::string(warning), "-" + flagName);
 			}
 			else if (flagName == "p:additional_include" || flagName == "p:i")
 			{
-				myAdditionalDirectories.push_back(Dequote(flagValue));
+				myOptions.myAdditionalDirectories.push_back(Dequote(flagValue));
+			}
+			else if (flagName == "p:config")
+			{
+				myOptions.myConfigurations.push_back(Dequote(flagValue));
 			}
 			else if (flagName == "dir")
 			{
 				potentialFiles.push_back(flagValue + "*.cpp");
-				myAdditionalDirectories.push_back(flagValue);
+				myOptions.myAdditionalDirectories.push_back(flagValue);
 			}
 			else if (flagName == "file" || flagName == "f")
 			{
@@ -397,7 +459,7 @@ std::vector<std::filesystem::path> CompilerContext::ParseCommandLine(int argc, c
 			}
 			else
 			{
-				myFlags.insert(std::pair(flagName, Dequote(flagValue)));
+				myOptions.myFlags.insert(std::pair(flagName, Dequote(flagValue)));
 			}
 		}
 		else
@@ -406,21 +468,26 @@ std::vector<std::filesystem::path> CompilerContext::ParseCommandLine(int argc, c
 		}
 	}
 
+	myOptions.mySwitches = {};
+	for (const compiler_context_internal::Switch& option : compiler_context_internal::SwitchTable)
+		if (std::optional<std::string> value = GetFlag(option.myFlag))
+			option.myParse(myOptions.mySwitches, *value);
+
 	if (!GetFlag("p:no_std"))
 	{
 		if (std::optional<std::string> dir = GetFlag("p:custom_std"))
-			myBaseDirectories.push_back(*dir);
+			myOptions.myBaseDirectories.push_back(*dir);
 		else
-			myBaseDirectories.push_back("std");
+			myOptions.myBaseDirectories.push_back("std");
 	}
 
 	if (!GetFlag("p:no_platform"))
 	{
 #if _WIN32
 		if (std::optional<std::string> dir = GetFlag("p:custom_windows"))
-			myBaseDirectories.push_back(*dir);
+			myOptions.myBaseDirectories.push_back(*dir);
 		else
-			myBaseDirectories.push_back("windows");
+			myOptions.myBaseDirectories.push_back("windows");
 #endif
 	}
 
@@ -485,21 +552,16 @@ std::vector<std::filesystem::path> CompilerContext::ParseCommandLine(int argc, c
 
 std::optional<const std::string> CompilerContext::GetFlag(const std::string_view& aFlag)
 {
-	if(myFlags.count(std::string(aFlag)) != 0)
+	if(myOptions.myFlags.count(std::string(aFlag)) != 0)
 	{
-		return myFlags.at(std::string(aFlag));
+		return myOptions.myFlags.at(std::string(aFlag));
 	}
 	return {};
 }
 
-bool CompilerContext::IsWarningEnabled(const std::string& aWarning)
-{
-	return myWarningSwitches.IsEnabled(aWarning);
-}
-
 CompilerContext::IgnoreHandle CompilerContext::IgnoreErrors()
 {
-	return IgnoreHandle(myIgnoreDepth);
+	return IgnoreHandle(myState->myIgnoreDepth);
 }
 
 CompilerContext::IgnoreHandle::IgnoreHandle(size_t& aIgnoreDepthPtr)
@@ -512,3 +574,38 @@ CompilerContext::IgnoreHandle::~IgnoreHandle()
 {
 	myIgnoreDepth--;
 }
+
+std::ostream& CompilerContext::Output()
+{
+	return myState->myOutput ? *myState->myOutput : std::cout;
+}
+
+CompilerContext::Redirect::Redirect(std::ostream& aOutput)
+	: myPrevious(std::exchange(myState->myOutput, &aOutput))
+{
+}
+
+CompilerContext::Redirect::~Redirect()
+{
+	myState->myOutput = myPrevious;
+}
+
+CompilerContext::Collect::Collect(std::vector<Diagnostic>& aOut)
+	: myPrevious(std::exchange(myState->myDiagnostics, &aOut))
+{
+}
+
+CompilerContext::Collect::~Collect()
+{
+	myState->myDiagnostics = myPrevious;
+}
+
+CompilerContext::Scope::Scope(State& aState)
+	: myPrevious(std::exchange(myState, &aState))
+{
+}
+
+CompilerContext::Scope::~Scope()
+{
+	myState = myPrevious;
+}
@@ -8,29 +8,105 @@
 #include <unordered_map>
 #include <optional>
 #include <filesystem>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <memory>
 
 #include "tokenizer/token.h"
+#include "common/Diagnostics.h"
 #include "common/FeatureSwitch.h"
 
 namespace {
 	thread_local size_t dummy;
 }
 
-std::string Escape(std::string aString, size_t& aOutEscapeCount = dummy);
+std::string Escape(std::string_view aString, size_t& aOutEscapeCount = dummy);
 std::string Dequote(std::string aString);
 
 class CompilerContext
 {
 public:
+	// The lines of a file that diagnostics quote from, shared with whoever read it so switching between files copies no text
+	using Source = std::shared_ptr<const std::vector<std::string>>;
+
+	// Where the compilation of one translation unit is, each thread works in one of its own unless handed another by a Scope
+	struct State
+	{
+		size_t myIgnoreDepth = 0;
+		size_t myErrorCount = 0;
+		size_t myCurrentLine = 0;
+		std::stack<std::filesystem::path> myFileStack;
+		Source myPrintContext;
+		std::stack<Source> myPrintContextStack;
+		std::ostream* myOutput = nullptr; // the console when not set
+		std::vector<Diagnostic>* myDiagnostics = nullptr; // printed or recorded as they come when not set
+	};
+
+	// Makes the current thread work in aState for as long as it is alive, so a translation unit can move between threads
+	class Scope
+	{
+	public:
+		Scope(State& aState);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		State* myPrevious;
+	};
+
 	static void EmitWarning(const std::string& aMessage, const tokenizer::Token& aToken);
-	static void EmitWarning(const std::string& aMessage, std::filesystem::path aFile = myFileStack.top(), size_t aColumn = npos, size_t aLine = myCurrentLine, size_t aSize = 1);
+	static void EmitWarning(const std::string& aMessage, std::filesystem::path aFile = myState->myFileStack.top(), size_t aColumn = npos, size_t aLine = myState->myCurrentLine, size_t aSize = 1);
 
 	static void EmitError(const std::string& aMessage, const tokenizer::Token& aToken);
-	static void EmitError(const std::string& aMessage, std::filesystem::path aFile = myFileStack.top(), size_t aColumn = npos, size_t aLine = myCurrentLine, size_t aSize = 1);
+	static void EmitError(const std::string& aMessage, std::filesystem::path aFile = myState->myFileStack.top(), size_t aColumn = npos, size_t aLine = myState->myCurrentLine, size_t aSize = 1);
+
+	// Where the current thread prints diagnostics and anything else it has to say, the console unless redirected
+	static std::ostream& Output();
+
+	// Sends everything the current thread prints into aOutput for as long as it is alive
+	class Redirect
+	{
+	public:
+		Redirect(std::ostream& aOutput);
+		~Redirect();
+
+		Redirect(const Redirect&) = delete;
+		Redirect& operator=(const Redirect&) = delete;
+
+	private:
+		std::ostream* myPrevious;
+	};
+
+	// Keeps every diagnostic the current thread emits in aOut instead of printing it, for as long as it is alive
+	class Collect
+	{
+	public:
+		Collect(std::vector<Diagnostic>& aOut);
+		~Collect();
+
+		Collect(const Collect&) = delete;
+		Collect& operator=(const Collect&) = delete;
+
+	private:
+		std::vector<Diagnostic>* myPrevious;
+	};
+
+	// Prints, records or collects a diagnostic that was already counted, one that was collected earlier or replayed from a cache
+	static void Deliver(const Diagnostic& aDiagnostic);
 
 	static std::optional<std::filesystem::path> FindFile(const std::filesystem::path& aPath, bool aExpandedLookup = false);
 
-	static void SetPrintContext(const std::vector<std::string>& aPrintContext);
+	// Remembers where every include was found, for a process that compiles many files
+	// Revalidating forgets all of it once a directory that was looked in has changed
+	static void EnableIncludeCache() { myIncludeCacheEnabled = true; }
+	static void RevalidateIncludeCache();
+
+	static void SetPrintContext(Source aPrintContext);
+	static const std::vector<std::string>& GetPrintContext();
 	static void SetCurrentLine(size_t aLine);
 	static size_t GetCurrentLine();
 
@@ -40,12 +116,44 @@ public:
 	static std::filesystem::path GetCurrentFile();
 
 	static bool HasErrors() { return myHasErrors; };
+	static void ClearErrors() { myHasErrors = false; }
+
+	// How many errors the current thread has emitted, to tell whether a piece of its work failed
+	static size_t GetErrorCount() { return myState->myErrorCount; }
+	// Fails the compilation without printing anything, for errors that were printed by a run that was cached or by another thread
+	static void AddReplayedError() { myHasErrors = true; myState->myErrorCount++; }
 
 	static std::vector<std::filesystem::path> ParseCommandLine(int argc, char** argv);
 
 	static std::optional<const std::string> GetFlag(const std::string_view& aFlag);
 
-	static bool IsWarningEnabled(const std::string& aWarning);
+	// What -verbose can print, it takes a comma separated list of them
+	enum class Verbose : uint32_t
+	{
+		Macros			= 1 << 0,
+		PrecompilerMath	= 1 << 1,
+		Includes		= 1 << 2,
+		Backtracking	= 1 << 3
+	};
+
+	// The flags checked for every line or expansion, parsed once by ParseCommandLine so checking one does not look it up
+	struct Switches
+	{
+		uint32_t myVerbose = 0;
+		bool myNoWhitespace = false;
+		bool myMacroCache = false;
+	};
+
+	static const Switches& GetSwitches() { return myOptions.mySwitches; }
+	static bool IsVerbose(Verbose aCategory) { return (myOptions.mySwitches.myVerbose & static_cast<uint32_t>(aCategory)) != 0; }
+
+	// The macro definitions of every -p:config, each is a comma separated list of NAME or NAME=VALUE
+	static const std::vector<std::string>& GetConfigurations() { return myOptions.myConfigurations; }
+
+	// Every flag that was given with its value, in the order given, leaving out the ones naming files to compile
+	static const std::vector<std::pair<std::string, std::string>>& GetCommandLineFlags() { return myOptions.myCommandLineFlags; }
+
+	static bool IsWarningEnabled(Warning aWarning) { return myOptions.myWarningSwitches.IsEnabled(aWarning); }
 
 	const static size_t npos = ~(0ull);
 
@@ -59,19 +167,36 @@ public:
 	};
 
 	static IgnoreHandle IgnoreErrors();
+	static bool IsIgnoringErrors() { return myState->myIgnoreDepth > 0; }
 
 private:
+	// What the command line asked for, written by ParseCommandLine before any work starts and only read after, shared by every thread
+	struct Options
+	{
+		FeatureSwitch myWarningSwitches;
+		std::vector<std::filesystem::path> myBaseDirectories;
+		std::vector<std::filesystem::path> myAdditionalDirectories;
+		std::unordered_map<std::string, std::string> myFlags;
+		std::vector<std::string> myConfigurations;
+		std::vector<std::pair<std::string, std::string>> myCommandLineFlags;
+		Switches mySwitches;
+	};
+
+	static Options										myOptions;
+	static std::atomic<bool>							myHasErrors;
+	static std::mutex									myOutputMutex;
+
+	static Diagnostic MakeDiagnostic(Diagnostic::Severity aSeverity, const std::string& aMessage, std::filesystem::path aFile, size_t aColumn, size_t aLine, size_t aSize);
+
+	static thread_local State							myThreadState;
+	static thread_local State*							myState;
+
+	static std::optional<std::filesystem::path> FindFileUncached(const std::filesystem::path& aPath, bool aExpandedLookup, std::vector<std::filesystem::path>& aOutLookedIn);
 
-	static FeatureSwitch								myWarningSwitches;
-	static size_t										myIgnoreDepth;
-	static bool											myHasErrors;
-	static size_t										myCurrentLine;
-	static std::stack<std::filesystem::path>			myFileStack;
-	static std::vector<std::string>						myPrintContext;
-	static std::stack<std::vector<std::string>>			myPrintContextStack;
-	static std::vector<std::filesystem::path>			myBaseDirectories;
-	static std::vector<std::filesystem::path>			myAdditionalDirectories;
-	static std::unordered_map<std::string, std::string> myFlags;
+	static bool											myIncludeCacheEnabled;
+	static std::mutex									myIncludeCacheMutex;
+	static std::unordered_map<std::string, std::optional<std::filesystem::path>> myIncludeCache;
+	static std::unordered_map<std::string, std::filesystem::file_time_type> myLookedInDirectories;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,230 @@
+#include "common/Diagnostics.h"
+
+#include <algorithm>
+#include <charconv>
+
+Diagnostics::Format Diagnostics::myFormat = Diagnostics::Format::Text;
+std::mutex Diagnostics::myMutex;
+std::vector<Diagnostic> Diagnostics::myRecorded;
+
+namespace diagnostics_internal
+{
+	const char* Label(Diagnostic::Severity aSeverity)
+	{
+		return aSeverity == Diagnostic::Severity::Error ? "ERROR" : "WARNING";
+	}
+
+	const char* Level(Diagnostic::Severity aSeverity)
+	{
+		return aSeverity == Diagnostic::Severity::Error ? "error" : "warning";
+	}
+
+	void AppendNumber(std::string& aOut, size_t aNumber)
+	{
+		char buffer[24];
+		std::to_chars_result result = std::to_chars(std::begin(buffer), std::end(buffer), aNumber);
+		aOut.append(buffer, result.ptr);
+	}
+
+	void AppendJsonString(std::string& aOut, std::string_view aText)
+	{
+		const char hex[] = "0123456789abcdef";
+
+		aOut += '"';
+		for (char c : aText)
+		{
+			switch (c)
+			{
+			case '"': aOut += "\\\""; break;
+			case '\\': aOut += "\\\\"; break;
+			case '\n': aOut += "\\n"; break;
+			case '\r': aOut += "\\r"; break;
+			case '\t': aOut += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					aOut += "\\u00";
+					aOut += hex[c >> 4];
+					aOut += hex[c & 0xf];
+				}
+				else
+				{
+					aOut += c;
+				}
+			}
+		}
+		aOut += '"';
+	}
+
+	// control characters are spelled out so the marker lines up, returns how many of them come before aColumn
+	size_t AppendEscaped(std::string& aOut, std::string_view aLine, size_t aColumn)
+	{
+		size_t before = 0;
+		for (size_t i = 0; i < aLine.size(); i++)
+		{
+			const char* escaped = nullptr;
+			switch (aLine[i])
+			{
+			case '\t': escaped = "\\t"; break;
+			case '\n': escaped = "\\n"; break;
+			case '\r': escaped = "\\r"; break;
+			case '\a': escaped = "\\a"; break;
+			case '\v': escaped = "\\v"; break;
+			case '\b': escaped = "\\b"; break;
+			}
+
+			if (!escaped)
+			{
+				aOut += aLine[i];
+				continue;
+			}
+
+			aOut += escaped;
+			if (i < aColumn)
+				before++;
+		}
+		return before;
+	}
+}
+
+Diagnostics::Text Diagnostics::ToText(const Diagnostic& aDiagnostic)
+{
+	using namespace diagnostics_internal;
+
+	Text out;
+	std::string& text = out.myText;
+	text.reserve(aDiagnostic.myMessage.size() + (aDiagnostic.mySourceLine ? aDiagnostic.mySourceLine->size() * 2 : 0) + 64);
+
+	text += Label(aDiagnostic.mySeverity);
+	out.myLabelEnd = text.size();
+
+	text += ' ';
+	text += aDiagnostic.myMessage;
+	text += " [in file ";
+	text += aDiagnostic.myFile.string();
+	text += ':';
+	AppendNumber(text, aDiagnostic.myLine);
+	text += ':';
+	if (aDiagnostic.myColumn == Diagnostic::EndOfLine)
+		text += "eol";
+	else
+		AppendNumber(text, aDiagnostic.myColumn);
+	text += "] \n";
+
+	if (!aDiagnostic.mySourceLine)
+	{
+		out.myMarkerBegin = out.myMarkerEnd = text.size();
+		return out;
+	}
+
+	size_t lineStart = text.size();
+	size_t escapesBefore = AppendEscaped(text, *aDiagnostic.mySourceLine, aDiagnostic.myColumn);
+	size_t lineLength = text.size() - lineStart;
+	text += '\n';
+
+	size_t indent = aDiagnostic.myColumn == Diagnostic::EndOfLine ? lineLength : aDiagnostic.myColumn + escapesBefore;
+	text.append(indent, ' ');
+
+	out.myMarkerBegin = text.size();
+	text += '^';
+	if (aDiagnostic.mySize > 1)
+		text.append(aDiagnostic.mySize - 1, '~');
+	out.myMarkerEnd = text.size();
+
+	text += "\n\n";
+	return out;
+}
+
+std::string Diagnostics::ToJson(std::span<const Diagnostic> aDiagnostics)
+{
+	using namespace diagnostics_internal;
+
+	std::string out = "[";
+	for (size_t i = 0; i < aDiagnostics.size(); i++)
+	{
+		const Diagnostic& diagnostic = aDiagnostics[i];
+
+		out += i == 0 ? "\n" : ",\n";
+		out += "\t{ \"severity\": \"";
+		out += Level(diagnostic.mySeverity);
+		out += "\", \"message\": ";
+		AppendJsonString(out, diagnostic.myMessage);
+		out += ", \"file\": ";
+		AppendJsonString(out, diagnostic.myFile.generic_string());
+		out += ", \"line\": ";
+		AppendNumber(out, diagnostic.myLine);
+		out += ", \"column\": ";
+		if (diagnostic.myColumn == Diagnostic::EndOfLine)
+			out += "null";
+		else
+			AppendNumber(out, diagnostic.myColumn);
+		out += ", \"length\": ";
+		AppendNumber(out, diagnostic.mySize);
+		out += " }";
+	}
+	out += "\n]\n";
+	return out;
+}
+
+std::string Diagnostics::ToSarif(std::span<const Diagnostic> aDiagnostics)
+{
+	using namespace diagnostics_internal;
+
+	std::string out =
+		"{\n"
+		"\t\"$schema\": \"https://json.schemastore.org/sarif-2.1.0.json\",\n"
+		"\t\"version\": \"2.1.0\",\n"
+		"\t\"runs\": [\n"
+		"\t\t{\n"
+		"\t\t\t\"tool\": { \"driver\": { \"name\": \"fiskCompiler\" } },\n"
+		"\t\t\t\"results\": [";
+
+	// sarif counts lines and columns from 1, diagnostics count them from 0
+	for (size_t i = 0; i < aDiagnostics.size(); i++)
+	{
+		const Diagnostic& diagnostic = aDiagnostics[i];
+
+		out += i == 0 ? "\n" : ",\n";
+		out += "\t\t\t\t{ \"level\": \"";
+		out += Level(diagnostic.mySeverity);
+		out += "\", \"message\": { \"text\": ";
+		AppendJsonString(out, diagnostic.myMessage);
+		out += " }, \"locations\": [ { \"physicalLocation\": { \"artifactLocation\": { \"uri\": ";
+		AppendJsonString(out, diagnostic.myFile.generic_string());
+		out += " }, \"region\": { \"startLine\": ";
+		AppendNumber(out, diagnostic.myLine + 1);
+		if (diagnostic.myColumn != Diagnostic::EndOfLine)
+		{
+			out += ", \"startColumn\": ";
+			AppendNumber(out, diagnostic.myColumn + 1);
+			out += ", \"endColumn\": ";
+			AppendNumber(out, diagnostic.myColumn + 1 + std::max<size_t>(diagnostic.mySize, 1));
+		}
+		out += " } } } ] }";
+	}
+
+	out +=
+		"\n"
+		"\t\t\t]\n"
+		"\t\t}\n"
+		"\t]\n"
+		"}\n";
+	return out;
+}
+
+void Diagnostics::Record(const Diagnostic& aDiagnostic)
+{
+	std::lock_guard lock(myMutex);
+	myRecorded.push_back(aDiagnostic);
+}
+
+std::string Diagnostics::TakeDocument()
+{
+	std::vector<Diagnostic> recorded;
+	{
+		std::lock_guard lock(myMutex);
+		recorded.swap(myRecorded);
+	}
+
+	return myFormat == Format::Sarif ? ToSarif(recorded) : ToJson(recorded);
+}
@@ -0,0 +1,71 @@
+#ifndef COMMON_DIAGNOSTICS_H
+#define COMMON_DIAGNOSTICS_H
+
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// One error or warning as it was emitted, kept as a record so it can be printed later or written as json or sarif
+struct Diagnostic
+{
+	enum class Severity
+	{
+		Warning,
+		Error
+	};
+
+	static constexpr size_t EndOfLine = ~size_t(0);
+
+	Severity mySeverity = Severity::Error;
+	std::string myMessage;
+	std::filesystem::path myFile;
+	size_t myLine = 0;
+	size_t myColumn = EndOfLine;
+	size_t mySize = 1;
+	std::optional<std::string> mySourceLine; // the line it points into, when it was known
+};
+
+// Renders diagnostics, and collects every diagnostic of the run when they are to be written as one json or sarif document
+class Diagnostics
+{
+public:
+	enum class Format
+	{
+		Text,
+		Json,
+		Sarif
+	};
+
+	static void SetFormat(Format aFormat) { myFormat = aFormat; }
+	static Format GetFormat() { return myFormat; }
+	static bool IsStructured() { return myFormat != Format::Text; }
+
+	// The diagnostic as it is printed to the console in one piece, with where the label and the marker under the source are
+	struct Text
+	{
+		std::string myText;
+		size_t myLabelEnd = 0;
+		size_t myMarkerBegin = 0;
+		size_t myMarkerEnd = 0;
+	};
+
+	static Text ToText(const Diagnostic& aDiagnostic);
+	static std::string ToJson(std::span<const Diagnostic> aDiagnostics);
+	static std::string ToSarif(std::span<const Diagnostic> aDiagnostics);
+
+	// Keeps the diagnostic for the document written at the end of the run, from any thread
+	static void Record(const Diagnostic& aDiagnostic);
+
+	// Everything recorded so far in the chosen format, recording starts over after
+	static std::string TakeDocument();
+
+private:
+	static Format					myFormat;
+	static std::mutex				myMutex;
+	static std::vector<Diagnostic>	myRecorded;
+};
+
+#endif
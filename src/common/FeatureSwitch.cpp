@@ -1,91 +1,64 @@
 #include "common/FeatureSwitch.h"
 
-#include <string>
-#include <fstream>
+#include <algorithm>
 #include <stack>
 
-#include <iostream>
-
-FeatureSwitch::FeatureSwitch(const std::string& aConfigFile)
+FeatureSwitch::FeatureSwitch()
 {
-	std::ifstream configFile(aConfigFile);
-	std::string line;
-	while (std::getline(configFile, line))
-	{
-		if(line == "")
-			continue;
-
-		if(line[0] == '#')
-			continue;
-
-		size_t colonPos = line.find(':');
-		if(colonPos == std::string::npos)
-			continue;
-
-		std::string name = line.substr(0, colonPos);
-		std::vector<std::string> mappings;
-
-		size_t at = colonPos + 1;
-		while (true)
-		{
-			size_t next = line.find(',', at);
-			if(next == std::string::npos)
-			{
-				mappings.push_back(line.substr(at));
-				break;
-			}
-			else
-			{
-				mappings.push_back(line.substr(at, next - at));
-				at = next + 1;
-			}
-		}
-
-		myCollections.emplace(name, mappings);
-	}
-
 	Enable("default");
 }
 
-void FeatureSwitch::Enable(const std::string_view& aFeatureOrCollection)
+bool FeatureSwitch::Enable(std::string_view aFeatureOrCollection)
 {
-	SetState(aFeatureOrCollection, State::Enabled);
+	return SetState(aFeatureOrCollection, true);
 }
 
-void FeatureSwitch::Disable(const std::string_view& aFeatureOrCollection)
+bool FeatureSwitch::Disable(std::string_view aFeatureOrCollection)
 {
-	SetState(aFeatureOrCollection, State::Disabled);
+	return SetState(aFeatureOrCollection, false);
 }
 
-bool FeatureSwitch::IsEnabled(const std::string& aFeature)
+std::optional<Warning> FeatureSwitch::Find(std::string_view aName)
 {
-	decltype(myFeatures)::iterator it = myFeatures.find(aFeature);
-	if (it == myFeatures.end())
-		return false;
+	const std::string_view* found = std::ranges::find(warnings_generated::Names, aName);
+	if (found == std::end(warnings_generated::Names))
+		return {};
 
-	return it->second == State::Enabled;
+	return static_cast<Warning>(found - std::begin(warnings_generated::Names));
 }
 
-void FeatureSwitch::SetState(const std::string_view& aFeatureOrCollection, State aState)
+bool FeatureSwitch::SetState(std::string_view aFeatureOrCollection, bool aEnabled)
 {
-	std::stack<std::string> stack;
-	stack.emplace(aFeatureOrCollection);
+	bool known = true;
+
+	std::stack<std::string_view> stack;
+	stack.push(aFeatureOrCollection);
 
 	while (!stack.empty())
 	{
-		std::string feature = stack.top();
+		std::string_view feature = stack.top();
 		stack.pop();
-		decltype(myCollections)::iterator collectionIt = myCollections.find(feature);
-		if (collectionIt != myCollections.end())
+
+		const warnings_generated::Collection* collection = std::ranges::find(warnings_generated::Collections, feature, &warnings_generated::Collection::myName);
+		if (collection != std::end(warnings_generated::Collections))
 		{
-			for (std::string& subfeature : collectionIt->second)
+			std::string_view members = collection->myMembers;
+			while (!members.empty())
 			{
-				stack.push(subfeature);
+				std::string_view member = members.substr(0, members.find(','));
+				members.remove_prefix(std::min(members.size(), member.size() + 1));
+				stack.push(member);
 			}
 		}
+		else if (std::optional<Warning> warning = Find(feature))
+		{
+			myEnabled.set(static_cast<size_t>(*warning), aEnabled);
+		}
 		else
 		{
-			myFeatures[feature] = aState;
+			known = false;
 		}
 	}
+
+	return known;
 }
@@ -1,31 +1,31 @@
 #ifndef COMMON_FEATURE_SWITCH_H
 #define COMMON_FEATURE_SWITCH_H
 
+#include <bitset>
+#include <optional>
 #include <string_view>
-#include <unordered_map>
-#include <string>
 
+#include "common/Warnings.generated.h"
+
+// Which warnings are enabled, the warnings and the collections grouping them are compiled in from data/data/warnings.txt
 class FeatureSwitch
 {
 public:
-	FeatureSwitch(const std::string& aConfigFile);
+	// Starts with the default collection enabled
+	FeatureSwitch();
 
-	void Enable(const std::string_view& aFeatureOrCollection);
-	void Disable(const std::string_view& aFeatureOrCollection);
+	// False when aFeatureOrCollection is neither a warning nor a collection
+	bool Enable(std::string_view aFeatureOrCollection);
+	bool Disable(std::string_view aFeatureOrCollection);
 
-	bool IsEnabled(const std::string& aFeature);
+	bool IsEnabled(Warning aWarning) const { return myEnabled.test(static_cast<size_t>(aWarning)); }
 
-private:
-	enum class State
-	{
-		Enabled,
-		Disabled
-	};
+	static std::optional<Warning> Find(std::string_view aName);
 
-	void SetState(const std::string_view& aFeatureOrCollection, State aState);
+private:
+	bool SetState(std::string_view aFeatureOrCollection, bool aEnabled);
 
-	std::unordered_map<std::string, std::vector<std::string>> myCollections;
-	std::unordered_map<std::string, State> myFeatures;
+	std::bitset<static_cast<size_t>(Warning::Count)> myEnabled;
 };
 
-#endif 
\ No newline at end of file
+#endif
@@ -0,0 +1,75 @@
+# Turns warnings.txt into Warnings.generated.h so the warnings are compiled in rather than read when starting
+# Each line is a collection, NAME:MEMBER,MEMBER,... where every member that is not a collection itself is a warning
+# Set WARNINGS_INPUT and WARNINGS_OUTPUT before including it, or pass them with -D when running it with -P
+
+file(STRINGS ${WARNINGS_INPUT} lines)
+
+set(collections "")
+set(members "")
+set(collection_rows "")
+foreach(line IN LISTS lines)
+	if(line MATCHES "^#")
+		continue()
+	endif()
+	if(NOT line MATCHES "^([^:]+):(.*)$")
+		continue()
+	endif()
+
+	set(name ${CMAKE_MATCH_1})
+	set(collection_members ${CMAKE_MATCH_2})
+
+	list(APPEND collections ${name})
+	string(APPEND collection_rows "\t\t{ \"${name}\", \"${collection_members}\" },\n")
+
+	string(REPLACE "," ";" collection_members "${collection_members}")
+	list(APPEND members ${collection_members})
+endforeach()
+
+set(warnings ${members})
+list(REMOVE_DUPLICATES warnings)
+list(REMOVE_ITEM warnings ${collections})
+
+set(enum_rows "")
+set(name_rows "")
+foreach(warning IN LISTS warnings)
+	string(APPEND enum_rows "\t${warning},\n")
+	string(APPEND name_rows "\t\t\"${warning}\",\n")
+endforeach()
+
+set(content "// Generated from warnings.txt by common/GenerateWarnings.cmake, edit that file instead
+#ifndef COMMON_WARNINGS_GENERATED_H
+#define COMMON_WARNINGS_GENERATED_H
+
+#include <string_view>
+
+// Every warning -w: can switch, named as in warnings.txt
+enum class Warning
+{
+${enum_rows}	Count
+};
+
+namespace warnings_generated
+{
+	// indexed by Warning
+	inline constexpr std::string_view Names[] =
+	{
+${name_rows}	};
+
+	struct Collection
+	{
+		std::string_view myName;
+		std::string_view myMembers; // comma separated, each a warning or another collection
+	};
+
+	inline constexpr Collection Collections[] =
+	{
+${collection_rows}	};
+}
+
+#endif
+")
+
+# only touched when it changes so editing a comment in warnings.txt rebuilds nothing
+file(WRITE ${WARNINGS_OUTPUT}.tmp "${content}")
+configure_file(${WARNINGS_OUTPUT}.tmp ${WARNINGS_OUTPUT} COPYONLY)
+file(REMOVE ${WARNINGS_OUTPUT}.tmp)
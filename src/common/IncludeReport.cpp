@@ -0,0 +1,138 @@
+#include "common/IncludeReport.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+bool IncludeReport::myIsEnabled = false;
+std::mutex IncludeReport::myMutex;
+std::unordered_map<std::string, IncludeReport::Entry> IncludeReport::myEntries;
+thread_local std::vector<IncludeReport::Frame> IncludeReport::myStack;
+
+namespace include_report_internal
+{
+	double Milliseconds(std::chrono::steady_clock::duration aDuration)
+	{
+		return std::chrono::duration<double, std::milli>(aDuration).count();
+	}
+
+	std::string Quoted(const std::string& aText, char aEscape)
+	{
+		std::string out = "\"";
+		for (char c : aText)
+		{
+			if (c == '"' || (aEscape == '\\' && c == '\\'))
+				out += aEscape;
+			out += c;
+		}
+		out += '"';
+		return out;
+	}
+}
+
+void IncludeReport::Enter(const std::filesystem::path& aFile)
+{
+	if (!myIsEnabled)
+		return;
+
+	Frame& frame = myStack.emplace_back();
+	frame.myFile = Key(aFile);
+	frame.myStart = Clock::now();
+}
+
+void IncludeReport::Leave()
+{
+	if (!myIsEnabled || myStack.empty())
+		return;
+
+	Frame frame = std::move(myStack.back());
+	myStack.pop_back();
+
+	Clock::duration elapsed = Clock::now() - frame.myStart;
+	if (!myStack.empty())
+		myStack.back().myChildren += elapsed;
+
+	std::lock_guard lock(myMutex);
+	Entry& entry = myEntries[frame.myFile];
+	entry.myInclusive += elapsed;
+	entry.myExclusive += elapsed - frame.myChildren;
+	entry.myBytes += frame.myBytes;
+	entry.myTokens += frame.myTokens;
+	entry.myExpansions += frame.myExpansions;
+	entry.myIncluded++;
+}
+
+void IncludeReport::Skip(const std::filesystem::path& aFile)
+{
+	if (!myIsEnabled)
+		return;
+
+	std::string key = Key(aFile);
+
+	std::lock_guard lock(myMutex);
+	myEntries[key].mySkipped++;
+}
+
+std::string IncludeReport::ToCsv()
+{
+	using namespace include_report_internal;
+
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3);
+	out << "file,included,skipped,inclusive_ms,exclusive_ms,bytes,tokens,macro_expansions\n";
+	for (const auto& [file, entry] : Sorted())
+	{
+		out << Quoted(file, '"') << "," << entry.myIncluded << "," << entry.mySkipped << ","
+			<< Milliseconds(entry.myInclusive) << "," << Milliseconds(entry.myExclusive) << ","
+			<< entry.myBytes << "," << entry.myTokens << "," << entry.myExpansions << "\n";
+	}
+	return out.str();
+}
+
+std::string IncludeReport::ToJson()
+{
+	using namespace include_report_internal;
+
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3);
+	out << "[";
+
+	bool first = true;
+	for (const auto& [file, entry] : Sorted())
+	{
+		out << (first ? "\n" : ",\n");
+		first = false;
+
+		out << "\t{ \"file\": " << Quoted(file, '\\')
+			<< ", \"included\": " << entry.myIncluded << ", \"skipped\": " << entry.mySkipped
+			<< ", \"inclusive_ms\": " << Milliseconds(entry.myInclusive) << ", \"exclusive_ms\": " << Milliseconds(entry.myExclusive)
+			<< ", \"bytes\": " << entry.myBytes << ", \"tokens\": " << entry.myTokens << ", \"macro_expansions\": " << entry.myExpansions << " }";
+	}
+	out << "\n]\n";
+	return out.str();
+}
+
+std::string IncludeReport::Key(const std::filesystem::path& aFile)
+{
+	std::error_code error;
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(aFile, error);
+	return (error ? aFile : canonical).generic_string();
+}
+
+std::vector<std::pair<std::string, IncludeReport::Entry>> IncludeReport::Sorted()
+{
+	std::vector<std::pair<std::string, Entry>> out;
+	{
+		std::lock_guard lock(myMutex);
+		out.assign(myEntries.begin(), myEntries.end());
+	}
+
+	std::ranges::sort(out, [](const std::pair<std::string, Entry>& aLeft, const std::pair<std::string, Entry>& aRight)
+		{
+			if (aLeft.second.myInclusive != aRight.second.myInclusive)
+				return aLeft.second.myInclusive > aRight.second.myInclusive;
+			return aLeft.first < aRight.first;
+		});
+
+	return out;
+}
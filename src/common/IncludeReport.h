@@ -0,0 +1,67 @@
+#ifndef COMMON_INCLUDE_REPORT_H
+#define COMMON_INCLUDE_REPORT_H
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What every file entered through CompilerContext::PushFile cost, work is attributed to whichever file is on top of the file stack
+// Does nothing unless enabled, the counters are only touched by the thread working on the file
+class IncludeReport
+{
+public:
+	static void Enable() { myIsEnabled = true; }
+	static bool IsEnabled() { return myIsEnabled; }
+
+	static void Enter(const std::filesystem::path& aFile);
+	static void Leave();
+
+	// An include that was not entered as the file had #pragma once
+	static void Skip(const std::filesystem::path& aFile);
+
+	static void CountBytes(size_t aBytes) { if (myIsEnabled && !myStack.empty()) myStack.back().myBytes += aBytes; }
+	static void CountTokens(size_t aTokens) { if (myIsEnabled && !myStack.empty()) myStack.back().myTokens += aTokens; }
+	static void CountExpansion() { if (myIsEnabled && !myStack.empty()) myStack.back().myExpansions++; }
+
+	// Most expensive file first, ordered by inclusive time
+	static std::string ToCsv();
+	static std::string ToJson();
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Entry
+	{
+		Clock::duration myInclusive{};
+		Clock::duration myExclusive{};
+		uint64_t myBytes = 0;
+		uint64_t myTokens = 0;
+		uint64_t myExpansions = 0;
+		uint64_t myIncluded = 0;
+		uint64_t mySkipped = 0;
+	};
+
+	struct Frame
+	{
+		std::string myFile;
+		Clock::time_point myStart;
+		Clock::duration myChildren{};
+		uint64_t myBytes = 0;
+		uint64_t myTokens = 0;
+		uint64_t myExpansions = 0;
+	};
+
+	static std::string Key(const std::filesystem::path& aFile);
+	static std::vector<std::pair<std::string, Entry>> Sorted();
+
+	static bool												myIsEnabled;
+	static std::mutex										myMutex;
+	static std::unordered_map<std::string, Entry>			myEntries;
+	static thread_local std::vector<Frame>					myStack;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "common/MacroStatistics.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+bool MacroStatistics::myIsEnabled = false;
+std::mutex MacroStatistics::myMutex;
+std::unordered_map<std::string, MacroStatistics::Entry> MacroStatistics::myEntries;
+thread_local MacroStatistics::ThreadEntries MacroStatistics::myThreadEntries;
+
+namespace macro_statistics_internal
+{
+	double Milliseconds(std::chrono::steady_clock::duration aDuration)
+	{
+		return std::chrono::duration<double, std::milli>(aDuration).count();
+	}
+}
+
+MacroStatistics::Invocation::Invocation(const std::string& aMacro, size_t aDepth)
+{
+	if (!myIsEnabled)
+		return;
+
+	myMacro = &aMacro;
+	myDepth = aDepth;
+	myStart = Clock::now();
+}
+
+MacroStatistics::Invocation::~Invocation()
+{
+	if (!myMacro)
+		return;
+
+	Entry& entry = myThreadEntries.myEntries[*myMacro];
+	entry.myInvocations++;
+	entry.myTokens += myTokens;
+	entry.myMaxDepth = std::max<uint64_t>(entry.myMaxDepth, myDepth);
+	entry.myTime += Clock::now() - myStart;
+}
+
+void MacroStatistics::Entry::Merge(const Entry& aOther)
+{
+	myInvocations += aOther.myInvocations;
+	myTokens += aOther.myTokens;
+	myMaxDepth = std::max(myMaxDepth, aOther.myMaxDepth);
+	myTime += aOther.myTime;
+}
+
+MacroStatistics::ThreadEntries::~ThreadEntries()
+{
+	std::lock_guard lock(myMutex);
+	for (const auto& [macro, entry] : myEntries)
+		MacroStatistics::myEntries[macro].Merge(entry);
+}
+
+std::string MacroStatistics::ToCsv(size_t aTop)
+{
+	using namespace macro_statistics_internal;
+
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3);
+	out << "macro,invocations,output_tokens,tokens_per_invocation,max_depth,time_ms\n";
+	for (const auto& [macro, entry] : Sorted(aTop))
+	{
+		out << macro << "," << entry.myInvocations << "," << entry.myTokens << ","
+			<< static_cast<double>(entry.myTokens) / entry.myInvocations << "," << entry.myMaxDepth << ","
+			<< Milliseconds(entry.myTime) << "\n";
+	}
+	return out.str();
+}
+
+std::string MacroStatistics::ToJson(size_t aTop)
+{
+	using namespace macro_statistics_internal;
+
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3);
+	out << "[";
+
+	bool first = true;
+	for (const auto& [macro, entry] : Sorted(aTop))
+	{
+		out << (first ? "\n" : ",\n");
+		first = false;
+
+		// identifiers need no escaping
+		out << "\t{ \"macro\": \"" << macro << "\""
+			<< ", \"invocations\": " << entry.myInvocations << ", \"output_tokens\": " << entry.myTokens
+			<< ", \"tokens_per_invocation\": " << static_cast<double>(entry.myTokens) / entry.myInvocations
+			<< ", \"max_depth\": " << entry.myMaxDepth << ", \"time_ms\": " << Milliseconds(entry.myTime) << " }";
+	}
+	out << "\n]\n";
+	return out.str();
+}
+
+std::vector<std::pair<std::string, MacroStatistics::Entry>> MacroStatistics::Sorted(size_t aTop)
+{
+	// threads that already ended have handed their totals over, the calling thread has not
+	std::unordered_map<std::string, Entry> merged;
+	{
+		std::lock_guard lock(myMutex);
+		merged = myEntries;
+	}
+	for (const auto& [macro, entry] : myThreadEntries.myEntries)
+		merged[macro].Merge(entry);
+
+	std::vector<std::pair<std::string, Entry>> out(merged.begin(), merged.end());
+	std::ranges::sort(out, [](const std::pair<std::string, Entry>& aLeft, const std::pair<std::string, Entry>& aRight)
+		{
+			if (aLeft.second.myTokens != aRight.second.myTokens)
+				return aLeft.second.myTokens > aRight.second.myTokens;
+			return aLeft.first < aRight.first;
+		});
+
+	if (out.size() > aTop)
+		out.resize(aTop);
+
+	return out;
+}
@@ -0,0 +1,71 @@
+#ifndef COMMON_MACRO_STATISTICS_H
+#define COMMON_MACRO_STATISTICS_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What every macro cost, counted per identifier: how often it was expanded, how many tokens its substitutions produced,
+// how deep in other expansions it was reached and how long substituting it took
+// Does nothing unless enabled, each thread counts on its own and hands its totals over when it ends
+class MacroStatistics
+{
+	using Clock = std::chrono::steady_clock;
+
+public:
+	static void Enable() { myIsEnabled = true; }
+	static bool IsEnabled() { return myIsEnabled; }
+
+	// Counts one expansion for as long as it is alive, the tokens are those of the substitution before it is rescanned
+	class Invocation
+	{
+	public:
+		Invocation(const std::string& aMacro, size_t aDepth);
+		~Invocation();
+
+		Invocation(const Invocation&) = delete;
+		Invocation& operator=(const Invocation&) = delete;
+
+		void Produced(size_t aTokens) { myTokens = aTokens; }
+
+	private:
+		const std::string* myMacro = nullptr;
+		size_t myDepth = 0;
+		size_t myTokens = 0;
+		Clock::time_point myStart;
+	};
+
+	// The macros that produced the most tokens, at most aTop of them
+	static std::string ToCsv(size_t aTop);
+	static std::string ToJson(size_t aTop);
+
+private:
+	struct Entry
+	{
+		uint64_t myInvocations = 0;
+		uint64_t myTokens = 0;
+		uint64_t myMaxDepth = 0;
+		Clock::duration myTime{};
+
+		void Merge(const Entry& aOther);
+	};
+
+	struct ThreadEntries
+	{
+		~ThreadEntries();
+
+		std::unordered_map<std::string, Entry> myEntries;
+	};
+
+	static std::vector<std::pair<std::string, Entry>> Sorted(size_t aTop);
+
+	static bool												myIsEnabled;
+	static std::mutex										myMutex;
+	static std::unordered_map<std::string, Entry>			myEntries;
+	static thread_local ThreadEntries						myThreadEntries;
+};
+
+#endif
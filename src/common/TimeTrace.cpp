@@ -0,0 +1,113 @@
+#include "common/TimeTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+
+bool TimeTrace::myIsEnabled = false;
+TimeTrace::Clock::time_point TimeTrace::myStart;
+std::mutex TimeTrace::myMutex;
+std::vector<TimeTrace::Event> TimeTrace::myEvents;
+thread_local TimeTrace::ThreadEvents TimeTrace::myThreadEvents;
+
+namespace time_trace_internal
+{
+	// the first thread to trace is 0, threads are numbered in the order they start tracing
+	std::atomic<uint64_t> ourNextThread = 0;
+
+	double Microseconds(std::chrono::steady_clock::duration aDuration)
+	{
+		return std::chrono::duration<double, std::micro>(aDuration).count();
+	}
+
+	std::string Quoted(std::string_view aText)
+	{
+		std::string out = "\"";
+		for (char c : aText)
+		{
+			if (c == '"' || c == '\\')
+				out += '\\';
+			out += c;
+		}
+		out += '"';
+		return out;
+	}
+}
+
+void TimeTrace::Enable()
+{
+	myStart = Clock::now();
+	myIsEnabled = true;
+}
+
+TimeTrace::Span::Span(const char* aName, std::string_view aDetail, Clock::duration aMinimum)
+{
+	if (!myIsEnabled)
+		return;
+
+	myName = aName;
+	myDetail = aDetail;
+	myMinimum = aMinimum;
+	myStart = Clock::now();
+}
+
+TimeTrace::Span::~Span()
+{
+	if (!myName)
+		return;
+
+	Clock::duration duration = Clock::now() - myStart;
+	if (duration < myMinimum)
+		return;
+
+	myThreadEvents.myEvents.push_back({ myName, std::move(myDetail), myStart, duration, myThreadEvents.myThread });
+}
+
+TimeTrace::ThreadEvents::ThreadEvents()
+	: myThread(time_trace_internal::ourNextThread++)
+{
+}
+
+TimeTrace::ThreadEvents::~ThreadEvents()
+{
+	if (myEvents.empty())
+		return;
+
+	std::lock_guard lock(myMutex);
+	TimeTrace::myEvents.insert(std::end(TimeTrace::myEvents), std::make_move_iterator(std::begin(myEvents)), std::make_move_iterator(std::end(myEvents)));
+}
+
+std::string TimeTrace::ToJson()
+{
+	using namespace time_trace_internal;
+
+	// threads that already ended have handed their spans over, the calling thread has not
+	std::vector<const Event*> events;
+	std::lock_guard lock(myMutex);
+	for (const Event& event : myEvents)
+		events.push_back(&event);
+	for (const Event& event : myThreadEvents.myEvents)
+		events.push_back(&event);
+
+	std::ranges::sort(events, [](const Event* aLeft, const Event* aRight) { return aLeft->myStart < aRight->myStart; });
+
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(3);
+	out << "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+	bool first = true;
+	for (const Event* event : events)
+	{
+		out << (first ? "\n" : ",\n");
+		first = false;
+
+		out << "\t{ \"name\": \"" << event->myName << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << event->myThread
+			<< ", \"ts\": " << Microseconds(event->myStart - myStart) << ", \"dur\": " << Microseconds(event->myDuration);
+		if (!event->myDetail.empty())
+			out << ", \"args\": { \"detail\": " << Quoted(event->myDetail) << " }";
+		out << " }";
+	}
+	out << "\n] }\n";
+	return out.str();
+}
@@ -0,0 +1,68 @@
+#ifndef COMMON_TIME_TRACE_H
+#define COMMON_TIME_TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// When every stage of the compilation ran on which thread, written as Chrome trace event json to be opened in chrome://tracing or Perfetto
+// Does nothing unless enabled, each thread keeps its own spans and hands them over when it ends
+class TimeTrace
+{
+	using Clock = std::chrono::steady_clock;
+
+public:
+	static void Enable();
+	static bool IsEnabled() { return myIsEnabled; }
+
+	// Times the work done for as long as it is alive, aName names the stage and has to outlive the trace, aDetail is what it worked on
+	// Spans shorter than aMinimum are left out, for work done too often to keep every one
+	class Span
+	{
+	public:
+		Span(const char* aName, std::string_view aDetail = {}, Clock::duration aMinimum = {});
+		~Span();
+
+		Span(const Span&) = delete;
+		Span& operator=(const Span&) = delete;
+
+	private:
+		const char* myName = nullptr;
+		std::string myDetail;
+		Clock::duration myMinimum;
+		Clock::time_point myStart;
+	};
+
+	// Every span of the threads that have ended and of the calling thread
+	static std::string ToJson();
+
+private:
+	struct Event
+	{
+		const char* myName;
+		std::string myDetail;
+		Clock::time_point myStart;
+		Clock::duration myDuration;
+		uint64_t myThread;
+	};
+
+	struct ThreadEvents
+	{
+		ThreadEvents();
+		~ThreadEvents();
+
+		uint64_t myThread;
+		std::vector<Event> myEvents;
+	};
+
+	static bool												myIsEnabled;
+	static Clock::time_point								myStart;
+	static std::mutex										myMutex;
+	static std::vector<Event>								myEvents;
+	static thread_local ThreadEvents						myThreadEvents;
+};
+
+#endif
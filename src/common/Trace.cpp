@@ -0,0 +1,116 @@
+#include "common/Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "tools/SpscRing.h"
+
+namespace trace_internal
+{
+	const size_t RingLines = 4096;
+
+	// how long lines wait in their rings at most before they are written out
+	const std::chrono::milliseconds WriteInterval(1);
+}
+
+struct Trace::Ring
+{
+	SpscRing<std::string> myLines = SpscRing<std::string>(trace_internal::RingLines);
+	std::atomic<bool> myIsDone = false; // set once the thread that owns it has ended
+};
+
+std::mutex Trace::myMutex;
+std::condition_variable Trace::myWakeUp;
+std::vector<std::shared_ptr<Trace::Ring>> Trace::myRings;
+std::thread Trace::myWriter;
+std::atomic<bool> Trace::myIsWriting = false;
+bool Trace::myIsStopping = false;
+thread_local Trace::ThreadRing Trace::myThreadRing;
+Trace::FlushAtExit Trace::myFlushAtExit; // defined last so the writer is stopped before anything it uses is destroyed
+
+Trace::Line::~Line()
+{
+	myText << '\n';
+	Write(std::move(myText).str());
+}
+
+Trace::ThreadRing::~ThreadRing()
+{
+	if (myRing)
+		myRing->myIsDone.store(true, std::memory_order_release);
+}
+
+void Trace::Flush()
+{
+	{
+		std::lock_guard lock(myMutex);
+		if (!myIsWriting.load(std::memory_order_relaxed))
+			return;
+
+		myIsStopping = true;
+	}
+	myWakeUp.notify_one();
+
+	myWriter.join();
+	myIsWriting.store(false, std::memory_order_relaxed);
+}
+
+void Trace::Write(std::string&& aLine)
+{
+	if (!myThreadRing.myRing)
+	{
+		myThreadRing.myRing = std::make_shared<Ring>();
+
+		std::lock_guard lock(myMutex);
+		myRings.push_back(myThreadRing.myRing);
+	}
+
+	if (!myIsWriting.load(std::memory_order_acquire))
+	{
+		std::lock_guard lock(myMutex);
+		if (!myIsWriting.load(std::memory_order_relaxed))
+		{
+			myIsStopping = false;
+			myWriter = std::thread(&Trace::WriteOut);
+			myIsWriting.store(true, std::memory_order_release);
+		}
+	}
+
+	// only waits when the writer has fallen a whole ring behind
+	myThreadRing.myRing->myLines.Push(std::move(aLine));
+}
+
+void Trace::WriteOut()
+{
+	std::unique_lock lock(myMutex);
+	while (true)
+	{
+		bool isStopping = myIsStopping;
+		std::vector<std::shared_ptr<Ring>> rings = myRings;
+		lock.unlock();
+
+		std::string out;
+		std::vector<Ring*> done;
+		for (const std::shared_ptr<Ring>& ring : rings)
+		{
+			// a thread that was seen to have ended before emptying its ring has nothing more to add to it
+			bool isDone = ring->myIsDone.load(std::memory_order_acquire);
+			while (std::optional<std::string> line = ring->myLines.TryPop())
+				out += *line;
+			if (isDone)
+				done.push_back(ring.get());
+		}
+
+		if (!out.empty())
+			std::cerr << out << std::flush;
+
+		lock.lock();
+		std::erase_if(myRings, [&done](const std::shared_ptr<Ring>& aRing) { return std::ranges::find(done, aRing.get()) != done.end(); });
+
+		if (isStopping)
+			return;
+
+		myWakeUp.wait_for(lock, trace_internal::WriteInterval, []() { return myIsStopping; });
+	}
+}
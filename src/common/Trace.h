@@ -0,0 +1,88 @@
+#ifndef COMMON_TRACE_H
+#define COMMON_TRACE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/CompilerContext.h"
+
+// Whether -verbose can print anything, release builds leave it out unless built with the FISK_TRACE cmake option
+#ifndef FISK_TRACE
+#ifdef NDEBUG
+#define FISK_TRACE 0
+#else
+#define FISK_TRACE 1
+#endif
+#endif
+
+// What -verbose prints, each thread hands its lines to a ring of its own that a writer thread empties onto stderr
+// so tracing takes no lock and threads never wait on each other's output
+// The lines of one thread keep their order, the lines of different threads are interleaved as they are written out
+class Trace
+{
+public:
+	static constexpr bool IsBuiltIn = FISK_TRACE;
+
+	// Whether lines of aCategory are printed, always false in builds without tracing so the lines are never built
+	static bool IsOn(CompilerContext::Verbose aCategory) { return IsBuiltIn && CompilerContext::IsVerbose(aCategory); }
+
+	// One line of output, printed once it goes out of scope, only made after checking IsOn
+	class Line
+	{
+	public:
+		Line() = default;
+		~Line();
+
+		Line(const Line&) = delete;
+		Line& operator=(const Line&) = delete;
+
+		template<class Value>
+		Line& operator<<(const Value& aValue)
+		{
+			myText << aValue;
+			return *this;
+		}
+
+	private:
+		std::ostringstream myText;
+	};
+
+	// Waits for every line traced so far to be printed and stops the writer, the next line starts it again
+	// Only called while no other thread is tracing, before forking and before leaving without running destructors
+	static void Flush();
+
+private:
+	struct Ring;
+
+	struct ThreadRing
+	{
+		~ThreadRing();
+
+		std::shared_ptr<Ring> myRing;
+	};
+
+	struct FlushAtExit
+	{
+		~FlushAtExit() { Flush(); }
+	};
+
+	static void Write(std::string&& aLine);
+	static void WriteOut();
+
+	static std::mutex									myMutex;
+	static std::condition_variable						myWakeUp;
+	static std::vector<std::shared_ptr<Ring>>			myRings;
+	static std::thread									myWriter;
+	static std::atomic<bool>							myIsWriting;
+	static bool											myIsStopping;
+	static thread_local ThreadRing						myThreadRing;
+	static FlushAtExit									myFlushAtExit;
+};
+
+#endif
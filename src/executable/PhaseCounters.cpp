@@ -0,0 +1,98 @@
+#include "PhaseCounters.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "common/CompilerContext.h"
+
+bool PhaseCounters::myIsOpen = false;
+std::mutex PhaseCounters::myMutex;
+std::vector<std::pair<std::string_view, PerfCounters::Values>> PhaseCounters::myPhases;
+thread_local std::optional<PerfCounters> PhaseCounters::myThreadCounters;
+
+void PhaseCounters::Open()
+{
+	if (!CompilerContext::GetFlag("perf_counters"))
+		return;
+
+	PerfCounters& counters = ThreadCounters();
+	if (!counters.IsAvailable())
+	{
+		CompilerContext::EmitWarning("Hardware performance counters are unavailable, " + counters.GetProblem(), "-perf_counters");
+		return;
+	}
+
+	myIsOpen = true;
+}
+
+PhaseCounters::Phase::Phase(const char* aName)
+{
+	if (!myIsOpen)
+		return;
+
+	PerfCounters& counters = ThreadCounters();
+	if (!counters.IsAvailable())
+		return;
+
+	myName = aName;
+	myStart = counters.Read();
+}
+
+PhaseCounters::Phase::~Phase()
+{
+	if (!myName)
+		return;
+
+	PerfCounters::Values end = ThreadCounters().Read();
+
+	std::lock_guard lock(myMutex);
+	auto phase = std::ranges::find(myPhases, std::string_view(myName), &std::pair<std::string_view, PerfCounters::Values>::first);
+	if (phase == std::end(myPhases))
+		phase = myPhases.insert(phase, { myName, {} });
+
+	for (size_t counter = 0; counter < PerfCounters::CounterCount; counter++)
+		phase->second[counter] += end[counter] - myStart[counter];
+}
+
+std::string PhaseCounters::ToText()
+{
+	// what is missing on this machine is left blank, the same counters open on every thread
+	const PerfCounters& counters = ThreadCounters();
+	auto perKilo = [](uint64_t aCount, uint64_t aInstructions) { return aInstructions == 0 ? 0.0 : aCount * 1000.0 / aInstructions; };
+
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(2);
+	out << std::left << std::setw(12) << "phase" << std::right << std::setw(16) << "cycles" << std::setw(16) << "instructions" << std::setw(8) << "ipc"
+		<< std::setw(16) << "branch_misses" << std::setw(12) << "per_1k" << std::setw(16) << "llc_misses" << std::setw(12) << "per_1k" << "\n";
+
+	std::lock_guard lock(myMutex);
+	for (const auto& [name, values] : myPhases)
+	{
+		uint64_t cycles = values[PerfCounters::Cycles];
+		uint64_t instructions = values[PerfCounters::Instructions];
+
+		out << std::left << std::setw(12) << name << std::right << std::setw(16) << cycles;
+		if (counters.Has(PerfCounters::Instructions))
+			out << std::setw(16) << instructions << std::setw(8) << (cycles == 0 ? 0.0 : static_cast<double>(instructions) / cycles);
+		else
+			out << std::setw(16) << "" << std::setw(8) << "";
+
+		for (PerfCounters::Counter counter : { PerfCounters::BranchMisses, PerfCounters::CacheMisses })
+		{
+			if (counters.Has(counter) && counters.Has(PerfCounters::Instructions))
+				out << std::setw(16) << values[counter] << std::setw(12) << perKilo(values[counter], instructions);
+			else
+				out << std::setw(16) << "" << std::setw(12) << "";
+		}
+		out << "\n";
+	}
+	return out.str();
+}
+
+PerfCounters& PhaseCounters::ThreadCounters()
+{
+	if (!myThreadCounters)
+		myThreadCounters.emplace();
+	return *myThreadCounters;
+}
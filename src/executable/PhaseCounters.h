@@ -0,0 +1,46 @@
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tools/PerfCounters.h"
+
+// What the hardware counted in each phase of compiling with -perf_counters, summed over every thread that worked on it
+// Tells whether a phase is held up by mispredicted branches or by cache misses rather than by how much it does
+class PhaseCounters
+{
+public:
+	// Starts counting when -perf_counters is given, warns and counts nothing when the counters can not be opened
+	static void Open();
+	static bool IsOpen() { return myIsOpen; }
+
+	// Counts the calling thread's work for as long as it is alive as part of aName, which has to outlive the counters
+	class Phase
+	{
+	public:
+		Phase(const char* aName);
+		~Phase();
+
+		Phase(const Phase&) = delete;
+		Phase& operator=(const Phase&) = delete;
+
+	private:
+		const char* myName = nullptr;
+		PerfCounters::Values myStart;
+	};
+
+	// A line per phase in the order they first ran, with instructions per cycle and misses per thousand instructions
+	static std::string ToText();
+
+private:
+	static PerfCounters& ThreadCounters();
+
+	static bool																myIsOpen;
+	static std::mutex														myMutex;
+	static std::vector<std::pair<std::string_view, PerfCounters::Values>>	myPhases;
+	static thread_local std::optional<PerfCounters>							myThreadCounters;
+};
@@ -0,0 +1,259 @@
+#include "ResultCache.h"
+
+#include <algorithm>
+#include <charconv>
+#include <sstream>
+#include <string_view>
+
+#include "common/CompilerContext.h"
+#include "tools/Hash.h"
+
+std::optional<DiskCache> ResultCache::myCache;
+std::mutex ResultCache::myMutex;
+
+namespace result_cache_internal
+{
+	const uint64_t DefaultSizeMiB = 1024;
+
+	// flags that only decide where output goes or how the process runs, leaving them out lets those runs share results
+	const std::string_view IgnoredFlags[] = { "cache_dir", "cache_size", "j", "p:pipeline", "diagnostics_format", "diagnostics_out", "artifact_dir", "report", "report_out", "report_top", "time_trace", "perf_counters", "fork_server", "daemon", "client", "watch" };
+
+	// the compiler that made a result, any rebuild of it invalidates everything it stored
+	const std::string& CompilerIdentity()
+	{
+		static const std::string identity = []()
+			{
+				std::string out = "fiskCompiler " __DATE__ " " __TIME__;
+#if __linux__
+				std::error_code error;
+				std::filesystem::path executable = std::filesystem::read_symlink("/proc/self/exe", error);
+				if (!error)
+				{
+					uint64_t size = std::filesystem::file_size(executable, error);
+					std::filesystem::file_time_type modified = std::filesystem::last_write_time(executable, error);
+					if (!error)
+						out += " " + std::to_string(size) + " " + std::to_string(modified.time_since_epoch().count());
+				}
+#endif
+				return out;
+			}();
+		return identity;
+	}
+
+	void AddString(Hash& aHash, std::string_view aString)
+	{
+		aHash.AddValue(aString.size());
+		aHash.Add(aString);
+	}
+
+	void AddSection(std::string& aOut, std::string_view aSection)
+	{
+		aOut += std::to_string(aSection.size());
+		aOut += '\n';
+		aOut += aSection;
+	}
+
+	void AddNumber(std::string& aOut, size_t aNumber)
+	{
+		AddSection(aOut, std::to_string(aNumber));
+	}
+
+	bool ReadSection(std::string_view& aData, std::string& aOutSection)
+	{
+		size_t newLine = aData.find('\n');
+		if (newLine == std::string_view::npos)
+			return false;
+
+		size_t size;
+		std::from_chars_result result = std::from_chars(aData.data(), aData.data() + newLine, size);
+		if (result.ec != std::errc() || result.ptr != aData.data() + newLine || size > aData.size() - newLine - 1)
+			return false;
+
+		aOutSection = aData.substr(newLine + 1, size);
+		aData.remove_prefix(newLine + 1 + size);
+		return true;
+	}
+
+	bool ReadNumber(std::string_view& aData, size_t& aOutNumber)
+	{
+		std::string section;
+		if (!ReadSection(aData, section))
+			return false;
+
+		std::from_chars_result result = std::from_chars(section.data(), section.data() + section.size(), aOutNumber);
+		return result.ec == std::errc() && result.ptr == section.data() + section.size();
+	}
+
+	void AddDiagnostic(std::string& aOut, const Diagnostic& aDiagnostic)
+	{
+		aOut += aDiagnostic.mySeverity == Diagnostic::Severity::Error ? 'e' : 'w';
+		AddSection(aOut, aDiagnostic.myMessage);
+		AddSection(aOut, aDiagnostic.myFile.string());
+		AddNumber(aOut, aDiagnostic.myLine);
+		AddNumber(aOut, aDiagnostic.myColumn);
+		AddNumber(aOut, aDiagnostic.mySize);
+		aOut += aDiagnostic.mySourceLine ? 's' : '-';
+		if (aDiagnostic.mySourceLine)
+			AddSection(aOut, *aDiagnostic.mySourceLine);
+	}
+
+	bool ReadDiagnostic(std::string_view& aData, Diagnostic& aOutDiagnostic)
+	{
+		if (aData.empty())
+			return false;
+		aOutDiagnostic.mySeverity = aData[0] == 'e' ? Diagnostic::Severity::Error : Diagnostic::Severity::Warning;
+		aData.remove_prefix(1);
+
+		std::string file;
+		if (!ReadSection(aData, aOutDiagnostic.myMessage) || !ReadSection(aData, file) || !ReadNumber(aData, aOutDiagnostic.myLine)
+			|| !ReadNumber(aData, aOutDiagnostic.myColumn) || !ReadNumber(aData, aOutDiagnostic.mySize) || aData.empty())
+			return false;
+		aOutDiagnostic.myFile = file;
+
+		bool hasSourceLine = aData[0] == 's';
+		aData.remove_prefix(1);
+		if (hasSourceLine)
+			return ReadSection(aData, aOutDiagnostic.mySourceLine.emplace());
+
+		return true;
+	}
+}
+
+void ResultCache::Open()
+{
+	using namespace result_cache_internal;
+
+	std::optional<std::string> directory = CompilerContext::GetFlag("cache_dir");
+	if (!directory)
+		return;
+
+	uint64_t sizeMiB = DefaultSizeMiB;
+	if (std::optional<std::string> sizeFlag = CompilerContext::GetFlag("cache_size"))
+	{
+		std::from_chars_result result = std::from_chars(sizeFlag->data(), sizeFlag->data() + sizeFlag->size(), sizeMiB);
+		if (result.ec != std::errc() || result.ptr != sizeFlag->data() + sizeFlag->size())
+		{
+			CompilerContext::EmitError("Expected a cache size in MiB, got " + *sizeFlag, "-cache_size");
+			return;
+		}
+	}
+
+	myCache.emplace(*directory, sizeMiB * 1024 * 1024);
+}
+
+uint64_t ResultCache::Key(const tokenizer::TokenStream& aTokens, const std::vector<std::string>& aPrintContext)
+{
+	using namespace result_cache_internal;
+
+	Hash hash;
+	AddString(hash, CompilerIdentity());
+
+	for (const auto& [flag, value] : CompilerContext::GetCommandLineFlags())
+	{
+		if (std::ranges::find(IgnoredFlags, flag) != std::end(IgnoredFlags))
+			continue;
+
+		AddString(hash, flag);
+		AddString(hash, value);
+	}
+
+	hash.AddValue(aPrintContext.size());
+	for (const std::string& line : aPrintContext)
+		AddString(hash, line);
+
+	// the file is only hashed where it changes, most tokens come from the same file as the one before them
+	const std::filesystem::path* file = nullptr;
+	for (const tokenizer::Token& token : aTokens)
+	{
+		if (!file || token.myFile.native() != file->native())
+		{
+			file = &token.myFile;
+			hash.AddValue('f');
+			AddString(hash, std::string_view(reinterpret_cast<const char*>(file->native().data()), file->native().size() * sizeof(std::filesystem::path::value_type)));
+		}
+
+		hash.AddValue(token.myType);
+		hash.AddValue(token.myLine);
+		hash.AddValue(token.myColumn);
+		AddString(hash, token.myRawText);
+	}
+
+	return hash.Get();
+}
+
+std::optional<ResultCache::Result> ResultCache::Get(uint64_t aKey)
+{
+	using namespace result_cache_internal;
+
+	if (!myCache)
+		return {};
+
+	std::optional<std::string> entry;
+	{
+		std::lock_guard lock(myMutex);
+		entry = myCache->Get(aKey);
+	}
+	if (!entry)
+		return {};
+
+	std::string_view data = *entry;
+	if (data.empty())
+		return {};
+
+	Result result;
+	result.myHasErrors = data[0] == 'e';
+	data.remove_prefix(1);
+
+	size_t diagnostics;
+	if (!ReadSection(data, result.myOutput) || !ReadNumber(data, diagnostics))
+		return {};
+
+	for (size_t i = 0; i < diagnostics; i++)
+	{
+		if (!ReadDiagnostic(data, result.myDiagnostics.emplace_back()))
+			return {};
+	}
+
+	if (!ReadSection(data, result.myMarkup) || !data.empty())
+		return {};
+
+	return result;
+}
+
+void ResultCache::Put(uint64_t aKey, const Result& aResult)
+{
+	using namespace result_cache_internal;
+
+	if (!myCache)
+		return;
+
+	std::string entry(1, aResult.myHasErrors ? 'e' : '-');
+	AddSection(entry, aResult.myOutput);
+	AddNumber(entry, aResult.myDiagnostics.size());
+	for (const Diagnostic& diagnostic : aResult.myDiagnostics)
+		AddDiagnostic(entry, diagnostic);
+	AddSection(entry, aResult.myMarkup);
+
+	std::lock_guard lock(myMutex);
+	myCache->Put(aKey, entry);
+}
+
+void ResultCache::Print(const Result& aResult)
+{
+	CompilerContext::Output() << aResult.myOutput;
+
+	for (const Diagnostic& diagnostic : aResult.myDiagnostics)
+		CompilerContext::Deliver(diagnostic);
+}
+
+ResultCache::Capture::Capture(Result& aOut)
+	: myOut(aOut)
+	, myRedirect(myStream)
+	, myCollect(aOut.myDiagnostics)
+{
+}
+
+ResultCache::Capture::~Capture()
+{
+	myOut.myOutput = std::move(myStream).str();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/CompilerContext.h"
+#include "tokenizer/tokenStream.h"
+#include "tools/DiskCache.h"
+
+// What compiling a translation unit past preprocessing produced, kept in the -cache_dir between runs
+// Looked up by a hash of the compiler build, the flags and the preprocessed tokens, so a hit skips markup and everything after it
+class ResultCache
+{
+public:
+	struct Result
+	{
+		bool myHasErrors = false;
+		std::string myOutput; // everything else printed while compiling, replayed as is
+		std::vector<Diagnostic> myDiagnostics;
+		std::string myMarkup; // the -dump markup output, empty unless it was asked for
+	};
+
+	// Opens the cache named by -cache_dir, nothing is cached without it
+	static void Open();
+	static bool IsOpen() { return myCache.has_value(); }
+
+	// aPrintContext is what diagnostics quote source lines from, they are part of the result
+	static uint64_t Key(const tokenizer::TokenStream& aTokens, const std::vector<std::string>& aPrintContext);
+
+	static std::optional<Result> Get(uint64_t aKey);
+	static void Put(uint64_t aKey, const Result& aResult);
+
+	// Prints the output and delivers the diagnostics of a result, the errors among them are not counted again
+	static void Print(const Result& aResult);
+
+	// Keeps what the current thread prints and the diagnostics it emits in aOut for as long as it is alive
+	class Capture
+	{
+	public:
+		Capture(Result& aOut);
+		~Capture();
+
+		Capture(const Capture&) = delete;
+		Capture& operator=(const Capture&) = delete;
+
+	private:
+		Result& myOut;
+		std::ostringstream myStream;
+		CompilerContext::Redirect myRedirect;
+		CompilerContext::Collect myCollect;
+	};
+
+private:
+	static std::optional<DiskCache>	myCache;
+	static std::mutex				myMutex;
+};
@@ -0,0 +1,226 @@
+#include "Server.h"
+
+#include <iostream>
+#include <sstream>
+
+#include "common/CompilerContext.h"
+#include "common/Trace.h"
+#include "precompiler/precompiler.h"
+#include "tokenizer/tokenizer.h"
+#include "tokenizer/tokenMatcher.h"
+#include "tools/LocalSocket.h"
+
+#include "main.h"
+
+#if __linux__
+#include <csignal>
+#include <unistd.h>
+#endif
+
+#if __linux__
+namespace server_internal
+{
+	// a request is the working directory and the file, each on their own line, the reply is the output then a 0 byte and the exit code
+	constexpr char ourEndOfOutput = '\0';
+
+	struct Request
+	{
+		std::string myWorkingDirectory;
+		std::filesystem::path myFile;
+	};
+
+	std::optional<Request> ReadRequest(const LocalSocket& aConnection)
+	{
+		std::string request = aConnection.ReadAll();
+
+		size_t split = request.find('\n');
+		size_t end = split == std::string::npos ? split : request.find('\n', split + 1);
+		if (end == std::string::npos)
+		{
+			CompilerContext::EmitError("Malformed request, expected a working directory and a file", "-client");
+			return {};
+		}
+
+		return Request{ request.substr(0, split), request.substr(split + 1, end - split - 1) };
+	}
+
+	bool EnterWorkingDirectory(const Request& aRequest)
+	{
+		if (chdir(aRequest.myWorkingDirectory.c_str()) == 0)
+			return true;
+
+		CompilerContext::EmitError("Failed to enter the working directory of the client", aRequest.myWorkingDirectory);
+		return false;
+	}
+
+	void Reply(const LocalSocket& aConnection, std::string_view aOutput)
+	{
+		int status = CompilerContext::HasErrors() ? EXIT_FAILURE : EXIT_SUCCESS;
+		aConnection.Write(std::string(aOutput) + ourEndOfOutput + std::to_string(status));
+	}
+
+	LocalSocket Listen(const std::filesystem::path& aSocket)
+	{
+		LocalSocket listener = LocalSocket::Listen(aSocket);
+		if (!listener.IsValid())
+			CompilerContext::EmitError("Failed to listen on socket", aSocket);
+		else
+			std::cout << "Listening on " << aSocket.string() << std::endl;
+
+		return listener;
+	}
+}
+
+int RunForkServer(Prelude& aPrelude, std::string_view aDefines, const std::filesystem::path& aSocket)
+{
+	using namespace server_internal;
+
+	tokenizer::TokenMatcher::LoadPatterns();
+
+	tokenizer::TokenStream tokens;
+	BeginTranslationUnit(aPrelude, aDefines, tokens);
+	if (CompilerContext::HasErrors())
+		return EXIT_FAILURE;
+
+	aPrelude.mySnapshotTokens = std::make_shared<const std::vector<tokenizer::Token>>(std::move(tokens).Get());
+	aPrelude.myIsResident = true;
+
+	LocalSocket listener = Listen(aSocket);
+	if (!listener.IsValid())
+		return EXIT_FAILURE;
+
+	// children are never waited for, they report to their client
+	std::signal(SIGCHLD, SIG_IGN);
+
+	while (LocalSocket connection = listener.Accept())
+	{
+		// anything still buffered would otherwise be printed by the child as well, and the trace writer thread does not survive the fork
+		Trace::Flush();
+		std::cout << std::flush;
+		std::cerr << std::flush;
+
+		pid_t child = fork();
+		if (child == 0)
+		{
+			listener = LocalSocket();
+
+			// everything printed from here on goes to the client
+			dup2(connection.GetHandle(), STDOUT_FILENO);
+			dup2(connection.GetHandle(), STDERR_FILENO);
+
+			std::optional<Request> request = ReadRequest(connection);
+			if (request && EnterWorkingDirectory(*request))
+				CompileFile(aPrelude, aDefines, request->myFile, ".i");
+
+			Trace::Flush();
+			std::cout << std::flush;
+			std::cerr << std::flush;
+			Reply(connection, "");
+
+			// the server's static state is not this process' to tear down
+			_exit(CompilerContext::HasErrors() ? EXIT_FAILURE : EXIT_SUCCESS);
+		}
+
+		if (child < 0)
+			connection.Write("Fork server failed to fork" + std::string(1, ourEndOfOutput) + std::to_string(EXIT_FAILURE));
+	}
+
+	CompilerContext::EmitError("Failed to accept connection", aSocket);
+	return EXIT_FAILURE;
+}
+
+int RunDaemon(Prelude& aPrelude, const std::filesystem::path& aSocket)
+{
+	using namespace server_internal;
+
+	tokenizer::TokenMatcher::LoadPatterns();
+	CompilerContext::EnableIncludeCache();
+	tokenizer::LineCache lineCache;
+
+	LocalSocket listener = Listen(aSocket);
+	if (!listener.IsValid())
+		return EXIT_FAILURE;
+
+	while (LocalSocket connection = listener.Accept())
+	{
+		// whatever the last file printed or failed with belongs to its own client, the trace stays on the daemon's stderr
+		std::ostringstream output;
+		{
+			CompilerContext::Redirect redirect(output);
+			CompilerContext::ClearErrors();
+
+			CompilerContext::RevalidateIncludeCache();
+			RevalidatePrelude(aPrelude);
+
+			std::optional<Request> request = ReadRequest(connection);
+			if (request && EnterWorkingDirectory(*request))
+				CompileFileConfigurations(aPrelude, request->myFile);
+		}
+
+		Reply(connection, output.view());
+	}
+
+	CompilerContext::EmitError("Failed to accept connection", aSocket);
+	return EXIT_FAILURE;
+}
+
+int RunClient(const std::filesystem::path& aSocket, const std::vector<std::filesystem::path>& aFiles)
+{
+	using namespace server_internal;
+
+	std::string workingDirectory = std::filesystem::current_path().string();
+
+	// every file is sent before any reply is read so the server can work on all of them at once
+	std::vector<LocalSocket> connections;
+	for (const std::filesystem::path& file : aFiles)
+	{
+		LocalSocket& connection = connections.emplace_back(LocalSocket::Connect(aSocket));
+		if (!connection.IsValid())
+		{
+			CompilerContext::EmitError("Failed to connect to server", aSocket);
+			continue;
+		}
+
+		connection.Write(workingDirectory + "\n" + file.string() + "\n");
+		connection.EndWrite();
+	}
+
+	int status = EXIT_SUCCESS;
+	for (const LocalSocket& connection : connections)
+	{
+		if (!connection.IsValid())
+		{
+			status = EXIT_FAILURE;
+			continue;
+		}
+
+		std::string reply = connection.ReadAll();
+
+		size_t end = reply.rfind(ourEndOfOutput);
+		std::cout << std::string_view(reply).substr(0, end);
+		if (end == std::string::npos || reply.substr(end + 1) != std::to_string(EXIT_SUCCESS))
+			status = EXIT_FAILURE;
+	}
+
+	std::cout << std::flush;
+	return status;
+}
+#else
+int RunForkServer(Prelude&, std::string_view, const std::filesystem::path& aSocket)
+{
+	CompilerContext::EmitError("-fork_server is only supported on linux", aSocket);
+	return EXIT_FAILURE;
+}
+
+int RunDaemon(Prelude&, const std::filesystem::path& aSocket)
+{
+	CompilerContext::EmitError("-daemon is only supported on linux", aSocket);
+	return EXIT_FAILURE;
+}
+
+int RunClient(const std::filesystem::path& aSocket, const std::vector<std::filesystem::path>&)
+{
+	CompilerContext::EmitError("-client is only supported on linux", aSocket);
+	return EXIT_FAILURE;
+}
+#endif
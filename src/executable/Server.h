@@ -0,0 +1,21 @@
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+struct Prelude;
+
+// Servers that compile the files a client sends over a unix socket, linux only, every file is compiled with the flags the server
+// was started with and what it printed is sent back to the client followed by its exit code
+
+// Preprocesses the prelude once then forks a child for every file, the child starts out with the macro table, caches and
+// token patterns of the server through copy on write
+int RunForkServer(Prelude& aPrelude, std::string_view aDefines, const std::filesystem::path& aSocket);
+
+// Compiles one file at a time in the same process, the lines of every file read and where every include was found are kept
+// between files and only redone once a file or a directory that was looked in changes
+int RunDaemon(Prelude& aPrelude, const std::filesystem::path& aSocket);
+
+// Sends every file to a server at once, then writes what each one printed in order of the files
+int RunClient(const std::filesystem::path& aSocket, const std::vector<std::filesystem::path>& aFiles);
@@ -0,0 +1,204 @@
+#include "Watch.h"
+
+#include <iostream>
+#include <set>
+#include <unordered_map>
+
+#include "common/CompilerContext.h"
+#include "tokenizer/tokenizer.h"
+#include "tokenizer/tokenMatcher.h"
+#include "tools/fileHelpers.h"
+
+#include "main.h"
+
+#if __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#if __linux__
+namespace watch_internal
+{
+	// how long to wait for more events once something changed, an editor saving a file is several events
+	constexpr int ourSettleMilliseconds = 50;
+
+	// Directories are watched rather than files, editors often save by replacing the file
+	class Watcher
+	{
+	public:
+		Watcher() : myHandle(inotify_init1(IN_CLOEXEC)) {}
+		~Watcher() { if (myHandle >= 0) close(myHandle); }
+
+		Watcher(const Watcher&) = delete;
+		Watcher& operator=(const Watcher&) = delete;
+
+		bool IsValid() const { return myHandle >= 0; }
+
+		void WatchDirectoryOf(const std::string& aFile)
+		{
+			WatchDirectory(std::filesystem::path(aFile).parent_path());
+		}
+
+		void WatchDirectory(const std::filesystem::path& aDirectory)
+		{
+			if (myDirectories.contains(aDirectory.native()))
+				return;
+
+			int watch = inotify_add_watch(myHandle, aDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE);
+			if (watch < 0)
+			{
+				CompilerContext::EmitWarning("Failed to watch directory", aDirectory);
+				return;
+			}
+
+			myDirectories.emplace(aDirectory.native(), watch);
+			myWatches.emplace(watch, aDirectory);
+		}
+
+		// Blocks until something changes, then collects changes until they settle
+		std::set<std::string> WaitForChanges()
+		{
+			std::set<std::string> changed;
+
+			int timeout = -1;
+			while (true)
+			{
+				pollfd poll{ myHandle, POLLIN, 0 };
+				int ready = ::poll(&poll, 1, timeout);
+				if (ready < 0 && errno == EINTR)
+					continue;
+				if (ready <= 0)
+					return changed;
+
+				alignas(inotify_event) char buffer[4096];
+				ssize_t got = read(myHandle, buffer, sizeof(buffer));
+				if (got <= 0)
+					return changed;
+
+				for (char* at = buffer; at < buffer + got; at += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(at)->len)
+				{
+					inotify_event* event = reinterpret_cast<inotify_event*>(at);
+					decltype(myWatches)::iterator directory = myWatches.find(event->wd);
+					if (directory != std::end(myWatches) && event->len > 0)
+						changed.insert(FileKey(directory->second / event->name));
+				}
+
+				timeout = ourSettleMilliseconds;
+			}
+		}
+
+	private:
+		int myHandle;
+		std::unordered_map<std::string, int> myDirectories;
+		std::unordered_map<int, std::filesystem::path> myWatches;
+	};
+
+	struct Unit
+	{
+		std::filesystem::path myFile;
+		std::vector<std::string> myDependencies = {};
+	};
+
+	void Compile(Prelude& aPrelude, Unit& aUnit, const std::vector<std::string>& aPreludeFiles, Watcher& aWatcher)
+	{
+		CompilerContext::ClearErrors();
+
+		aUnit.myDependencies = aPreludeFiles;
+		aUnit.myDependencies.push_back(FileKey(aUnit.myFile));
+		for (const std::filesystem::path& included : CompileFileConfigurations(aPrelude, aUnit.myFile))
+			aUnit.myDependencies.push_back(included.generic_string());
+
+		for (const std::string& dependency : aUnit.myDependencies)
+			aWatcher.WatchDirectoryOf(dependency);
+
+		std::cout << "Compiled " << aUnit.myFile.string() << (CompilerContext::HasErrors() ? " with errors" : "") << std::endl;
+	}
+}
+
+int RunWatch(Prelude& aPrelude, const std::filesystem::path& aDirectory, const std::vector<std::filesystem::path>& aFiles)
+{
+	using namespace watch_internal;
+
+	Watcher watcher;
+	if (!watcher.IsValid())
+	{
+		CompilerContext::EmitError("Failed to start watching", aDirectory);
+		return EXIT_FAILURE;
+	}
+
+	tokenizer::TokenMatcher::LoadPatterns();
+	CompilerContext::EnableIncludeCache();
+	tokenizer::LineCache lineCache;
+
+	bool fromDirectory = aFiles.empty();
+	std::vector<Unit> units;
+	for (const std::filesystem::path& file : aFiles)
+		units.push_back({ file });
+
+	if (fromDirectory)
+	{
+		std::error_code error;
+		for (std::filesystem::recursive_directory_iterator it(aDirectory, error), end; !error && it != end; it.increment(error))
+		{
+			if (it->is_regular_file() && it->path().extension() == ".cpp")
+				units.push_back({ std::filesystem::relative(it->path()) });
+		}
+
+		watcher.WatchDirectory(FileKey(aDirectory));
+	}
+
+	std::vector<std::string> preludeFiles;
+	if (aPrelude.myHeader)
+		preludeFiles.push_back(FileKey(*aPrelude.myHeader));
+	if (std::optional<std::string> snapshot = CompilerContext::GetFlag("pch_in"))
+		preludeFiles.push_back(FileKey(*snapshot));
+
+	for (Unit& unit : units)
+		Compile(aPrelude, unit, preludeFiles, watcher);
+
+	std::cout << "Watching " << units.size() << " files" << std::endl;
+
+	while (true)
+	{
+		std::set<std::string> changed = watcher.WaitForChanges();
+		if (changed.empty())
+			break;
+
+		CompilerContext::RevalidateIncludeCache();
+		RevalidatePrelude(aPrelude);
+
+		std::set<std::string> known;
+		for (Unit& unit : units)
+		{
+			known.insert(FileKey(unit.myFile));
+
+			if (IsAnyChanged(unit.myDependencies, changed))
+				Compile(aPrelude, unit, preludeFiles, watcher);
+		}
+
+		if (!fromDirectory)
+			continue;
+
+		// new files only count once they are in the directory
+		for (const std::string& file : changed)
+		{
+			std::filesystem::path path = file;
+			if (path.extension() != ".cpp" || known.contains(file) || !std::filesystem::is_regular_file(path))
+				continue;
+
+			Unit& unit = units.emplace_back(Unit{ std::filesystem::relative(path) });
+			Compile(aPrelude, unit, preludeFiles, watcher);
+		}
+	}
+
+	CompilerContext::EmitError("Stopped watching", aDirectory);
+	return EXIT_FAILURE;
+}
+#else
+int RunWatch(Prelude&, const std::filesystem::path& aDirectory, const std::vector<std::filesystem::path>&)
+{
+	CompilerContext::EmitError("-watch is only supported on linux", aDirectory);
+	return EXIT_FAILURE;
+}
+#endif
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+struct Prelude;
+
+// Linux only, compiles every file then keeps running, watching the files and everything they include through inotify and
+// recompiling only the files a change affects, without any files the .cpp files in the directory are compiled
+int RunWatch(Prelude& aPrelude, const std::filesystem::path& aDirectory, const std::vector<std::filesystem::path>& aFiles);
@@ -1,16 +1,35 @@
 
+#include <charconv>
 #include <iostream>
+#include <mutex>
+#include <numeric>
+#include <set>
 #include <fstream>
+#include <sstream>
+#include <thread>
 
 #include "common/CompilerContext.h"
 #include "common/HelpPrinter.h"
+#include "common/IncludeReport.h"
+#include "common/MacroStatistics.h"
+#include "common/TimeTrace.h"
 
 #include "tokenizer/tokenizer.h"
 #include "markup/Patterns.h"
+#include "precompiler/precompiler.h"
+#include "precompiler/PrecompiledHeader.h"
+#include "precompiler/PreprocessedOutput.h"
+#include "precompiler/DependencyScanner.h"
+#include "tools/BufferedWriter.h"
+#include "tools/WorkStealingPool.h"
+#include "PhaseCounters.h"
+#include "ResultCache.h"
+#include "Server.h"
+#include "Watch.h"
 #include "main.h"
 
 
-std::optional<std::ofstream> GetArtifactsFile(std::filesystem::path aPath, std::string extension)
+std::optional<std::filesystem::path> GetArtifactsPath(std::filesystem::path aPath, std::string extension)
 {
 	if (std::optional<std::string> outDir = CompilerContext::GetFlag("artifact_dir"))
 	{
@@ -20,26 +39,43 @@ std::optional<std::ofstream> GetArtifactsFile(std::filesystem::path aPath, std::
 		if (!std::filesystem::exists(p))
 			std::filesystem::create_directories(p);
 
+		// files compiling at once on several threads each get their own name, even before either has created its file
+		static std::mutex mutex;
+		static std::set<std::filesystem::path> handedOut;
+		std::lock_guard lock(mutex);
+
 		p /= aPath.stem().string() + extension;
 		size_t counter = 1;
-		while (std::filesystem::exists(p))
+		while (std::filesystem::exists(p) || handedOut.contains(p))
 		{
 			p = p.parent_path();
 			p /= aPath.stem().string() + std::to_string(counter) + extension;
 			counter++;
 		}
 
-		return std::ofstream(p);
+		handedOut.insert(p);
+		return p;
 	}
 
 	return {};
 }
 
-void DumpTokens(std::vector<tokenizer::Token>& tokens, std::filesystem::path aPath)
+std::optional<std::ofstream> GetArtifactsFile(std::filesystem::path aPath, std::string extension)
+{
+	if (std::optional<std::filesystem::path> path = GetArtifactsPath(aPath, extension))
+		return std::ofstream(*path);
+
+	return {};
+}
+
+void DumpTokens(const tokenizer::TokenStream& tokens, std::filesystem::path aPath)
 {
+	TimeTrace::Span span("DumpTokens", TimeTrace::IsEnabled() ? aPath.generic_string() : std::string());
+	PhaseCounters::Phase phase("dump");
+
 	std::string line;
 	std::string annotation;
-	std::ostream* out = &std::cout;
+	std::ostream* out = &CompilerContext::Output();
 	std::ofstream file;
 	size_t columnLimit = 120;
 
@@ -59,7 +95,7 @@ void DumpTokens(std::vector<tokenizer::Token>& tokens, std::filesystem::path aPa
 	}
 
 
-	for (tokenizer::Token& tok : tokens)
+	for (const tokenizer::Token& tok : tokens)
 	{
 		while (annotation.length() > line.length()) { line += ' '; }
 		while (line.length() > annotation.length()) { annotation += ' '; }
@@ -76,60 +112,594 @@ void DumpTokens(std::vector<tokenizer::Token>& tokens, std::filesystem::path aPa
 	*out << line << "\n" << annotation << "\n\n";
 }
 
-void DumpMarkup(const markup::TranslationUnit& aMarkup, std::filesystem::path aPath)
+void DumpMarkup(std::string_view aMarkup, std::filesystem::path aPath)
 {
-	std::ostream* out = &std::cout;
-	std::ofstream file;
-	size_t columnLimit = 120;
+	TimeTrace::Span span("DumpMarkup", TimeTrace::IsEnabled() ? aPath.generic_string() : std::string());
+	PhaseCounters::Phase phase("dump");
 
 	if (std::optional<std::ofstream> dumpFile = GetArtifactsFile(aPath, ".markup"))
 	{
-		if (*dumpFile)
-		{
-			file = std::move(*dumpFile);
-			out = &file;
-		}
-		else
+		if (!*dumpFile)
 		{
 			CompilerContext::EmitError("Failed to create file to write markup output to", aPath);
 			return;
 		}
+
+		*dumpFile << aMarkup;
+		return;
 	}
 
-	*out << aMarkup;
+	CompilerContext::Output() << aMarkup;
 }
 
+// Writes the diagnostics of the run as one json or sarif document when it ends
+struct DiagnosticsDocument
+{
+	~DiagnosticsDocument() { Write(); }
+
+	// Modes that serve files until they are stopped never end the document, they only print text
+	bool IsSupportedBy(const std::string& aMode)
+	{
+		if (!Diagnostics::IsStructured())
+			return true;
+
+		CompilerContext::EmitError("json and sarif diagnostics are written when the run ends, which " + aMode + " never does", "-diagnostics_format");
+		return false;
+	}
+
+	void Write()
+	{
+		if (!Diagnostics::IsStructured())
+			return;
+
+		std::string document = Diagnostics::TakeDocument();
+		Diagnostics::SetFormat(Diagnostics::Format::Text);
+
+		if (std::optional<std::string> outPath = CompilerContext::GetFlag("diagnostics_out"))
+		{
+			std::ofstream file(*outPath, std::ios::binary);
+			if (!file.write(document.data(), document.size()))
+				CompilerContext::EmitError("Failed to write diagnostics", *outPath);
+			return;
+		}
+
+		std::cout << document;
+	}
+};
+
 void printHelp()
 {
 	HelpPrinter printer;
 	printer.Emit();
 }
 
+void LoadSnapshot(Prelude& aOutPrelude)
+{
+	const std::filesystem::path& snapshotIn = *aOutPrelude.mySnapshotIn;
+
+	std::error_code error;
+	aOutPrelude.mySnapshotModified = std::filesystem::last_write_time(snapshotIn, error);
+	aOutPrelude.mySnapshotSize = error ? 0 : std::filesystem::file_size(snapshotIn, error);
+
+	// made for the first configuration, the others preprocess the prelude it was made from
+	const std::vector<std::string>& configurations = CompilerContext::GetConfigurations();
+	aOutPrelude.mySnapshot.emplace(snapshotIn, configurations.empty() ? std::string_view() : std::string_view(configurations.front()));
+
+	// a snapshot that can not be used still knows what it was made from
+	if (!aOutPrelude.myHeader && !aOutPrelude.mySnapshot->GetPrelude().empty())
+		aOutPrelude.myHeader = aOutPrelude.mySnapshot->GetPrelude();
+
+	if (!aOutPrelude.mySnapshot->GetProblem().empty())
+	{
+		CompilerContext::EmitWarning("Precompiled header can not be used, " + aOutPrelude.mySnapshot->GetProblem(), snapshotIn);
+		aOutPrelude.mySnapshot.reset();
+	}
+}
+
+void LoadPrelude(Prelude& aOutPrelude)
+{
+	if (std::optional<std::string> header = CompilerContext::GetFlag("pch_header"))
+		aOutPrelude.myHeader = *header;
+
+	if (std::optional<std::string> snapshotOut = CompilerContext::GetFlag("pch_out"))
+	{
+		if (!aOutPrelude.myHeader)
+			CompilerContext::EmitError("-pch_out needs a prelude, use -pch_header <file>", *snapshotOut);
+		else
+			aOutPrelude.mySnapshotOut = *snapshotOut;
+	}
+
+	if (std::optional<std::string> snapshotIn = CompilerContext::GetFlag("pch_in"))
+	{
+		aOutPrelude.mySnapshotIn = *snapshotIn;
+		LoadSnapshot(aOutPrelude);
+	}
+}
+
+void RevalidatePrelude(Prelude& aPrelude)
+{
+	if (!aPrelude.mySnapshotIn)
+		return;
+
+	std::error_code error;
+	std::filesystem::file_time_type modified = std::filesystem::last_write_time(*aPrelude.mySnapshotIn, error);
+	std::uintmax_t size = error ? 0 : std::filesystem::file_size(*aPrelude.mySnapshotIn, error);
+
+	// a snapshot that could not be used is only looked at again once it is written again
+	bool snapshotChanged = error || modified != aPrelude.mySnapshotModified || size != aPrelude.mySnapshotSize;
+	if (!snapshotChanged && !(aPrelude.mySnapshot && aPrelude.mySnapshot->HasChanged()))
+		return;
+
+	aPrelude.mySnapshot.reset();
+	aPrelude.mySnapshotTokens.reset();
+	LoadSnapshot(aPrelude);
+}
+
+void BeginTranslationUnit(Prelude& aPrelude, std::string_view aDefines, tokenizer::TokenStream& aOutTokens)
+{
+	if (aPrelude.myIsResident)
+	{
+		aOutTokens.Splice(aPrelude.mySnapshotTokens);
+		return;
+	}
+
+	Precompiler::ResetContext();
+
+	if (aPrelude.mySnapshot && aPrelude.mySnapshot->GetDefines() == aDefines)
+	{
+		aPrelude.mySnapshot->Apply();
+		Precompiler::Predefine(aDefines);
+		if (!aPrelude.mySnapshotTokens)
+			aPrelude.mySnapshotTokens = std::make_shared<const std::vector<tokenizer::Token>>(aPrelude.mySnapshot->GetTokens());
+
+		aOutTokens.Splice(aPrelude.mySnapshotTokens);
+		return;
+	}
+
+	Precompiler::Predefine(aDefines);
+
+	if (!aPrelude.myHeader)
+		return;
+
+	CompilerContext::PushFile(*aPrelude.myHeader);
+	std::shared_ptr<const std::vector<tokenizer::Token>> tokens = std::make_shared<const std::vector<tokenizer::Token>>(tokenizer::Tokenize(*aPrelude.myHeader));
+	CompilerContext::PopFile();
+
+	if (aPrelude.mySnapshotOut)
+	{
+		PrecompiledHeader::Write(*aPrelude.mySnapshotOut, *aPrelude.myHeader, aDefines, *tokens);
+		aPrelude.mySnapshotOut.reset();
+	}
+
+	aOutTokens.Splice(std::move(tokens));
+}
+
+void PreprocessOnly(Prelude& aPrelude, std::string_view aDefines, std::filesystem::path aPath, const std::string& aExtension)
+{
+	std::filesystem::path outPath = GetArtifactsPath(aPath, aExtension).value_or(std::filesystem::path(aPath).replace_extension(aExtension));
+
+	BufferedWriter writer(outPath);
+	if (!writer.Good())
+	{
+		CompilerContext::EmitError("Failed to create file to write preprocessed output to", outPath);
+		return;
+	}
+
+	{
+		TimeTrace::Span span("Preprocess", TimeTrace::IsEnabled() ? aPath.generic_string() : std::string());
+		PhaseCounters::Phase phase("preprocess");
+
+		PreprocessedOutput output(writer);
+		tokenizer::TokenStream stream(output);
+
+		BeginTranslationUnit(aPrelude, aDefines, stream);
+
+		CompilerContext::PushFile(aPath);
+		tokenizer::Tokenize(aPath, stream);
+		CompilerContext::PopFile();
+	}
+
+	writer.Flush();
+	if (!writer.Good())
+		CompilerContext::EmitError("Failed to write preprocessed output", outPath);
+}
+
+void CompileFile(Prelude& aPrelude, std::string_view aDefines, const std::filesystem::path& aFile, const std::string& aPreprocessedExtension)
+{
+	std::string file = TimeTrace::IsEnabled() ? aFile.generic_string() : std::string();
+	TimeTrace::Span span("CompileFile", file);
+
+	if (CompilerContext::GetFlag("preprocess_only"))
+	{
+		PreprocessOnly(aPrelude, aDefines, aFile, aPreprocessedExtension);
+		return;
+	}
+
+	tokenizer::TokenStream tokens;
+	{
+		TimeTrace::Span preprocessSpan("Preprocess", file);
+		PhaseCounters::Phase preprocessPhase("preprocess");
+
+		BeginTranslationUnit(aPrelude, aDefines, tokens);
+
+		CompilerContext::PushFile(aFile);
+
+		tokenizer::Tokenize(aFile, tokens);
+	}
+
+	if (CompilerContext::GetFlag("dump") == "tokens") DumpTokens(tokens, aFile);
+
+	bool dumpMarkup = CompilerContext::GetFlag("dump") == "markup";
+
+	std::optional<uint64_t> cacheKey;
+	if (ResultCache::IsOpen())
+	{
+		cacheKey = ResultCache::Key(tokens, CompilerContext::GetPrintContext());
+		if (std::optional<ResultCache::Result> cached = ResultCache::Get(*cacheKey))
+		{
+			ResultCache::Print(*cached);
+			if (cached->myHasErrors)
+				CompilerContext::AddReplayedError();
+
+			if (dumpMarkup) DumpMarkup(cached->myMarkup, aFile);
+
+			CompilerContext::PopFile();
+			return;
+		}
+	}
+
+	ResultCache::Result result;
+	{
+		// a result that is going to be cached has its diagnostics collected to be replayed by later hits
+		std::optional<ResultCache::Capture> capture;
+		if (cacheKey)
+			capture.emplace(result);
+
+		size_t errors = CompilerContext::GetErrorCount();
+
+		markup::TranslationUnit translationUnit;
+		{
+			TimeTrace::Span markupSpan("Markup", file);
+			PhaseCounters::Phase markupPhase("markup");
+			translationUnit = markup::Markup(tokens);
+		}
+
+		if (dumpMarkup)
+		{
+			TimeTrace::Span printSpan("PrintMarkup", file);
+			PhaseCounters::Phase printPhase("dump");
+			std::ostringstream markup;
+			markup << translationUnit;
+			result.myMarkup = std::move(markup).str();
+		}
+
+		result.myHasErrors = CompilerContext::GetErrorCount() != errors;
+	}
+
+	if (cacheKey)
+	{
+		ResultCache::Print(result);
+		ResultCache::Put(*cacheKey, result);
+	}
+
+	if (dumpMarkup) DumpMarkup(result.myMarkup, aFile);
+
+	CompilerContext::PopFile();
+}
+
+std::vector<std::filesystem::path> CompileFileConfigurations(Prelude& aPrelude, const std::filesystem::path& aFile)
+{
+	std::vector<std::filesystem::path> included;
+
+	const std::vector<std::string>& configurations = CompilerContext::GetConfigurations();
+
+	// every configuration after the first reuses the lines the first one tokenized
+	std::optional<tokenizer::LineCache> lineCache;
+	if (configurations.size() > 1 && !tokenizer::LineCache::IsActive())
+		lineCache.emplace();
+
+	for (size_t configuration = 0; configuration < std::max<size_t>(configurations.size(), 1); configuration++)
+	{
+		std::string_view defines = configurations.empty() ? std::string_view() : std::string_view(configurations[configuration]);
+
+		CompileFile(aPrelude, defines, aFile, configurations.size() > 1 ? "." + std::to_string(configuration) + ".i" : ".i");
+
+		const std::vector<std::filesystem::path>& configurationIncluded = Precompiler::GetIncludedFiles();
+		included.insert(std::end(included), std::begin(configurationIncluded), std::end(configurationIncluded));
+	}
+
+	return included;
+}
+
+// The prelude is only read once files compile on several threads, what it would fill in on first use is filled in here
+void SharePrelude(Prelude& aPrelude)
+{
+	PhaseCounters::Phase phase("prelude");
+
+	if (aPrelude.mySnapshot && !aPrelude.mySnapshotTokens)
+		aPrelude.mySnapshotTokens = std::make_shared<const std::vector<tokenizer::Token>>(aPrelude.mySnapshot->GetTokens());
+
+	if (aPrelude.mySnapshotOut)
+	{
+		const std::vector<std::string>& configurations = CompilerContext::GetConfigurations();
+
+		tokenizer::TokenStream discarded;
+		BeginTranslationUnit(aPrelude, configurations.empty() ? std::string_view() : std::string_view(configurations.front()), discarded);
+	}
+}
+
+void CompileFilesInParallel(Prelude& aPrelude, const std::vector<std::filesystem::path>& aFiles, size_t aJobs)
+{
+	SharePrelude(aPrelude);
+
+	// the largest files are started first so that none of them is left running alone at the end
+	std::vector<uint64_t> sizes;
+	for (const std::filesystem::path& file : aFiles)
+	{
+		std::error_code error;
+		uint64_t size = std::filesystem::file_size(file, error);
+		sizes.push_back(error ? 0 : size);
+	}
+
+	std::vector<size_t> order(aFiles.size());
+	std::iota(std::begin(order), std::end(order), 0);
+	std::ranges::stable_sort(order, [&sizes](size_t aLeft, size_t aRight) { return sizes[aLeft] > sizes[aRight]; });
+
+	// what every file printed is held back until all files given before it have been printed
+	struct Output
+	{
+		std::string myText;
+		std::vector<Diagnostic> myDiagnostics; // only for a json or sarif document, text diagnostics are in the text
+	};
+
+	std::mutex outputMutex;
+	std::vector<std::optional<Output>> outputs(aFiles.size());
+	size_t printed = 0;
+
+	WorkStealingPool::Run(order.size(), aJobs, [&](size_t aTask)
+		{
+			size_t file = order[aTask];
+
+			Output result;
+			{
+				std::ostringstream output;
+				CompilerContext::Redirect redirect(output);
+
+				std::optional<CompilerContext::Collect> collect;
+				if (Diagnostics::IsStructured())
+					collect.emplace(result.myDiagnostics);
+
+				CompileFileConfigurations(aPrelude, aFiles[file]);
+				result.myText = std::move(output).str();
+			}
+
+			std::lock_guard lock(outputMutex);
+			outputs[file] = std::move(result);
+			for (; printed < outputs.size() && outputs[printed]; printed++)
+			{
+				std::cout << outputs[printed]->myText;
+				for (const Diagnostic& diagnostic : outputs[printed]->myDiagnostics)
+					Diagnostics::Record(diagnostic);
+				outputs[printed]->myText.clear();
+				outputs[printed]->myDiagnostics.clear();
+			}
+			std::cout << std::flush;
+		});
+}
+
+int ScanDependencies(const Prelude& aPrelude, const std::vector<std::filesystem::path>& aFiles, const std::string& aFormat)
+{
+	if (aFormat != "" && aFormat != "make" && aFormat != "json")
+	{
+		CompilerContext::EmitError("Unknown dependency format " + aFormat + ", expected make or json", "-scan_deps");
+		return EXIT_FAILURE;
+	}
+
+	std::optional<std::filesystem::path> header = aPrelude.myHeader;
+	if (!header && aPrelude.mySnapshot)
+		header = aPrelude.mySnapshot->GetPrelude();
+
+	DependencyScanner scanner;
+	std::vector<DependencyScanner::Dependencies> dependencies = scanner.Scan(aFiles, header, CompilerContext::GetConfigurations(), std::max(std::thread::hardware_concurrency(), 1u));
+
+	std::string out = aFormat == "json" ? DependencyScanner::ToJson(aFiles, dependencies) : DependencyScanner::ToMake(aFiles, dependencies);
+
+	if (std::optional<std::string> outPath = CompilerContext::GetFlag("scan_deps_out"))
+	{
+		std::ofstream file(*outPath, std::ios::binary);
+		if (!file.write(out.data(), out.size()))
+			CompilerContext::EmitError("Failed to write dependencies", *outPath);
+	}
+	else
+	{
+		std::cout << out;
+	}
+
+	return CompilerContext::HasErrors() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+void WriteReport()
+{
+	std::optional<std::string> outPath = CompilerContext::GetFlag("report_out");
+	bool json = outPath && std::filesystem::path(*outPath).extension() == ".json";
+
+	std::string out;
+	if (IncludeReport::IsEnabled())
+	{
+		out = json ? IncludeReport::ToJson() : IncludeReport::ToCsv();
+	}
+	else
+	{
+		size_t top = 20;
+		if (std::optional<std::string> topFlag = CompilerContext::GetFlag("report_top"))
+		{
+			std::from_chars_result result = std::from_chars(topFlag->data(), topFlag->data() + topFlag->size(), top);
+			if (result.ec != std::errc() || result.ptr != topFlag->data() + topFlag->size())
+				CompilerContext::EmitError("Expected a number of macros to report, got " + *topFlag, "-report_top");
+		}
+
+		out = json ? MacroStatistics::ToJson(top) : MacroStatistics::ToCsv(top);
+	}
+
+	if (!outPath)
+	{
+		std::cout << out;
+		return;
+	}
+
+	std::ofstream file(*outPath, std::ios::binary);
+	if (!file.write(out.data(), out.size()))
+		CompilerContext::EmitError("Failed to write report", *outPath);
+}
+
+void WriteTimeTrace()
+{
+	std::string outPath = *CompilerContext::GetFlag("time_trace");
+	std::string out = TimeTrace::ToJson();
+
+	std::ofstream file(outPath, std::ios::binary);
+	if (!file.write(out.data(), out.size()))
+		CompilerContext::EmitError("Failed to write time trace", outPath);
+}
 
 int main(int argc, char** argv)
 {
 	std::vector<std::filesystem::path> files = CompilerContext::ParseCommandLine(argc, argv);
 
+	if (std::optional<std::string> format = CompilerContext::GetFlag("diagnostics_format"))
+	{
+		if (*format == "json")
+			Diagnostics::SetFormat(Diagnostics::Format::Json);
+		else if (*format == "sarif")
+			Diagnostics::SetFormat(Diagnostics::Format::Sarif);
+		else if (*format != "text")
+			CompilerContext::EmitError("Unknown diagnostics format " + *format + ", expected text, json or sarif", "-diagnostics_format");
+	}
+	DiagnosticsDocument diagnosticsDocument;
+
+	if (std::optional<std::string> report = CompilerContext::GetFlag("report"))
+	{
+		if (*report == "includes")
+			IncludeReport::Enable();
+		else if (*report == "macros")
+			MacroStatistics::Enable();
+		else
+			CompilerContext::EmitError("Unknown report " + *report + ", expected includes or macros", "-report");
+	}
+
+	if (std::optional<std::string> timeTrace = CompilerContext::GetFlag("time_trace"))
+	{
+		if (timeTrace->empty())
+			CompilerContext::EmitError("Expected a file to write the time trace to", "-time_trace");
+		else
+			TimeTrace::Enable();
+	}
+
+	if (CompilerContext::GetFlag("p:pipeline"))
+		tokenizer::EnablePipeline();
+
+	ResultCache::Open();
+
+	PhaseCounters::Open();
+
+	Prelude prelude;
+	{
+		PhaseCounters::Phase phase("prelude");
+		LoadPrelude(prelude);
+	}
+
+	const std::vector<std::string>& configurations = CompilerContext::GetConfigurations();
+
+	if (std::optional<std::string> socket = CompilerContext::GetFlag("fork_server"))
+	{
+		if (configurations.size() > 1)
+		{
+			CompilerContext::EmitError("A fork server holds a single configuration, give at most one -p:config", "-fork_server");
+			return EXIT_FAILURE;
+		}
+
+		if (!diagnosticsDocument.IsSupportedBy("-fork_server"))
+			return EXIT_FAILURE;
+
+		return RunForkServer(prelude, configurations.empty() ? std::string_view() : std::string_view(configurations.front()), *socket);
+	}
+
+	if (std::optional<std::string> socket = CompilerContext::GetFlag("daemon"))
+	{
+		if (!diagnosticsDocument.IsSupportedBy("-daemon"))
+			return EXIT_FAILURE;
+
+		return RunDaemon(prelude, *socket);
+	}
+
+	if (files.empty() && prelude.mySnapshotOut && !CompilerContext::HasErrors())
+	{
+		tokenizer::TokenStream discarded;
+		BeginTranslationUnit(prelude, configurations.empty() ? std::string_view() : std::string_view(configurations.front()), discarded);
+		return CompilerContext::HasErrors() ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	if (std::optional<std::string> directory = CompilerContext::GetFlag("watch"))
+	{
+		if (!diagnosticsDocument.IsSupportedBy("-watch"))
+			return EXIT_FAILURE;
+
+		return RunWatch(prelude, *directory, files);
+	}
+
 	if (files.empty() || CompilerContext::GetFlag("help") || CompilerContext::GetFlag("h"))
 	{
 		printHelp();
 		return EXIT_FAILURE;
 	}
 
-	for (std::filesystem::path file : files)
+	if (std::optional<std::string> format = CompilerContext::GetFlag("scan_deps"))
+		return ScanDependencies(prelude, files, *format);
+
+	if (std::optional<std::string> socket = CompilerContext::GetFlag("client"))
 	{
-		CompilerContext::PushFile(file);
+		if (!diagnosticsDocument.IsSupportedBy("-client"))
+			return EXIT_FAILURE;
 
-		std::vector<tokenizer::Token> tokens = tokenizer::Tokenize(file);
+		return RunClient(*socket, files);
+	}
 
-		if (CompilerContext::GetFlag("dump") == "tokens") DumpTokens(tokens, file);
+	size_t jobs = 1;
+	if (std::optional<std::string> jobsFlag = CompilerContext::GetFlag("j"))
+	{
+		if (jobsFlag->empty())
+		{
+			jobs = std::max(std::thread::hardware_concurrency(), 1u);
+		}
+		else
+		{
+			std::from_chars_result result = std::from_chars(jobsFlag->data(), jobsFlag->data() + jobsFlag->size(), jobs);
+			if (result.ec != std::errc() || result.ptr != jobsFlag->data() + jobsFlag->size() || jobs == 0)
+			{
+				CompilerContext::EmitError("Expected a number of files to compile at once, got " + *jobsFlag, "-j");
+				return EXIT_FAILURE;
+			}
+		}
+	}
 
-		markup::TranslationUnit translationUnit = markup::Markup(tokens);
+	if (jobs > 1 && files.size() > 1)
+	{
+		CompileFilesInParallel(prelude, files, jobs);
+	}
+	else
+	{
+		for (std::filesystem::path file : files)
+			CompileFileConfigurations(prelude, file);
+	}
 
-		if (CompilerContext::GetFlag("dump") == "markup") DumpMarkup(translationUnit, file);
+	if (IncludeReport::IsEnabled() || MacroStatistics::IsEnabled())
+		WriteReport();
 
-		CompilerContext::PopFile();
-	}
+	if (TimeTrace::IsEnabled())
+		WriteTimeTrace();
+
+	if (PhaseCounters::IsOpen())
+		std::cout << PhaseCounters::ToText();
 
 	return CompilerContext::HasErrors() ? EXIT_FAILURE : EXIT_SUCCESS;
 }
\ No newline at end of file
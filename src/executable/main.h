@@ -1 +1,36 @@
-#pragma once
\ No newline at end of file
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "precompiler/PrecompiledHeader.h"
+#include "tokenizer/token.h"
+#include "tokenizer/tokenStream.h"
+
+// Where every translation unit starts from, either a snapshot or a prelude header that is preprocessed in front of each one
+struct Prelude
+{
+	std::optional<std::filesystem::path> myHeader;
+	std::optional<PrecompiledHeader> mySnapshot;
+	std::optional<std::filesystem::path> mySnapshotIn; // where mySnapshot was opened from, even when it could not be used
+	std::filesystem::file_time_type mySnapshotModified;
+	std::uintmax_t mySnapshotSize = 0;
+	std::optional<std::filesystem::path> mySnapshotOut;
+	std::shared_ptr<const std::vector<tokenizer::Token>> mySnapshotTokens; // read once and spliced into every file
+	bool myIsResident = false; // the preprocessor already holds the prelude, only ever the case in a process forked for a single file
+};
+
+void BeginTranslationUnit(Prelude& aPrelude, std::string_view aDefines, tokenizer::TokenStream& aOutTokens);
+
+// For processes that compile many times from the same prelude, opens the snapshot again once it or a file it was made from changed
+void RevalidatePrelude(Prelude& aPrelude);
+
+// Preprocesses and compiles a file, or only preprocesses it into <file><aPreprocessedExtension> with -preprocess_only
+void CompileFile(Prelude& aPrelude, std::string_view aDefines, const std::filesystem::path& aFile, const std::string& aPreprocessedExtension);
+
+// Compiles the file once for every -p:config, or once if there are none, returns every file any of them included
+std::vector<std::filesystem::path> CompileFileConfigurations(Prelude& aPrelude, const std::filesystem::path& aFile);
@@ -2,17 +2,19 @@
 #include "markup/Patterns.h"
 #include "markup/Concepts.h"
 
+#include "common/Trace.h"
 #include "common/Utility.h"
 
 #include <numeric>
+#include <span>
 
 namespace markup 
 {
 	class TokenStream
 	{
 	public:
-		using iterator = std::vector<tokenizer::Token>::const_iterator;
-		TokenStream(const std::vector<tokenizer::Token>& aTokens)
+		using iterator = tokenizer::TokenStream::const_iterator;
+		TokenStream(const tokenizer::TokenStream& aTokens)
 		{
 			myBegin = aTokens.begin();
 			myEnd = aTokens.end();
@@ -132,7 +134,7 @@ namespace markup
 		iterator myEnd;
 	};
 
-	size_t indent = 0;
+	thread_local size_t indent = 0; // files printed on different threads with -j each have their own
 
 	
 	template<AssignableBy<EmptyDeclaration> T>
@@ -354,36 +356,39 @@ namespace markup
 		return true;
 	}
 
-	bool ParseDeclaration(TokenStream& aStream, Declaration& aOut)
-	{
-		if (ParseBlockDeclaration(aStream, aOut))
-			return true;
-
-		if (ParseFunctionDeclaration(aStream, aOut))
-			return true;
-
-		if (ParseTemplateDeclaration(aStream, aOut))
-			return true;
+	using DeclarationKind = std::pair<const char*, bool (*)(TokenStream&, Declaration&)>;
 
-		if (ParseExplicitInstantiation(aStream, aOut))
-			return true;
-
-		if (ParseExplicitSpecialization(aStream, aOut))
-			return true;
-
-		if (ParseLinkageSpecification(aStream, aOut))
-			return true;
+	// each kind is tried from the same token, every one that does not match is a step back
+	static bool ParseFirstOf(std::span<const DeclarationKind> aKinds, TokenStream& aStream, Declaration& aOut)
+	{
+		for (const auto& [kind, parse] : aKinds)
+		{
+			if (parse(aStream, aOut))
+				return true;
 
-		if (ParseNamespaceDefinition(aStream, aOut))
-			return true;
+			if (Trace::IsOn(CompilerContext::Verbose::Backtracking) && !aStream.Empty())
+				Trace::Line() << "gave up on " << kind << " at " << aStream.Token().myLine << ":" << aStream.Token().myColumn;
+		}
 
-		if (ParseEmptyDeclaration(aStream, aOut))
-			return true;
+		return false;
+	}
 
-		if (ParseAttributeDeclaration(aStream, aOut))
-			return true;
+	bool ParseDeclaration(TokenStream& aStream, Declaration& aOut)
+	{
+		static const DeclarationKind kinds[] =
+		{
+			{ "block declaration",			&ParseBlockDeclaration<Declaration> },
+			{ "function declaration",		&ParseFunctionDeclaration<Declaration> },
+			{ "template declaration",		&ParseTemplateDeclaration<Declaration> },
+			{ "explicit instantiation",		&ParseExplicitInstantiation<Declaration> },
+			{ "explicit specialization",	&ParseExplicitSpecialization<Declaration> },
+			{ "linkage specification",		&ParseLinkageSpecification<Declaration> },
+			{ "namespace definition",		&ParseNamespaceDefinition<Declaration> },
+			{ "empty declaration",			&ParseEmptyDeclaration<Declaration> },
+			{ "attribute declaration",		&ParseAttributeDeclaration<Declaration> }
+		};
 
-		return false;
+		return ParseFirstOf(kinds, aStream, aOut);
 	}
 
 	bool ParseRBraceTerminatedDeclarations(TokenStream& aStream, std::vector<Declaration>& aOutDeclarations)
@@ -1641,46 +1646,24 @@ namespace markup
 
 	bool ParseTranslation(TokenStream& aStream, TranslationUnit& aOutUnit)
 	{
+		// the same kinds as any other declaration, except for explicit specializations
+		static const DeclarationKind kinds[] =
+		{
+			{ "block declaration",			&ParseBlockDeclaration<Declaration> },
+			{ "function declaration",		&ParseFunctionDeclaration<Declaration> },
+			{ "template declaration",		&ParseTemplateDeclaration<Declaration> },
+			{ "explicit instantiation",		&ParseExplicitInstantiation<Declaration> },
+			{ "linkage specification",		&ParseLinkageSpecification<Declaration> },
+			{ "namespace definition",		&ParseNamespaceDefinition<Declaration> },
+			{ "empty declaration",			&ParseEmptyDeclaration<Declaration> },
+			{ "attribute declaration",		&ParseAttributeDeclaration<Declaration> }
+		};
+
 		while (!aStream.Empty())
 		{
 			Declaration decl;
 
-			if (ParseBlockDeclaration(aStream, decl))
-			{
-				aOutUnit.myDeclarations.push_back(decl);
-				continue;
-			}
-			if (ParseFunctionDeclaration(aStream, decl))
-			{
-				aOutUnit.myDeclarations.push_back(decl);
-				continue;
-			}
-			if (ParseTemplateDeclaration(aStream, decl))
-			{
-				aOutUnit.myDeclarations.push_back(decl);
-				continue;
-			}
-			if (ParseExplicitInstantiation(aStream, decl))
-			{
-				aOutUnit.myDeclarations.push_back(decl);
-				continue;
-			}
-			if (ParseLinkageSpecification(aStream, decl))
-			{
-				aOutUnit.myDeclarations.push_back(decl);
-				continue;
-			}
-			if (ParseNamespaceDefinition(aStream, decl))
-			{
-				aOutUnit.myDeclarations.push_back(decl);
-				continue;
-			}
-			if (ParseEmptyDeclaration(aStream, decl))
-			{
-				aOutUnit.myDeclarations.push_back(decl);
-				continue;
-			}
-			if (ParseAttributeDeclaration(aStream, decl))
+			if (ParseFirstOf(kinds, aStream, decl))
 			{
 				aOutUnit.myDeclarations.push_back(decl);
 				continue;
@@ -1697,7 +1680,7 @@ namespace markup
 		return "\n" + std::string(indent, ' ');
 	}
 
-	TranslationUnit Markup(const std::vector<tokenizer::Token>& aTokens)
+	TranslationUnit Markup(const tokenizer::TokenStream& aTokens)
 	{
 		TokenStream stream(aTokens);
 		TranslationUnit unit;
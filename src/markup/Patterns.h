@@ -2,6 +2,7 @@
 #define COMPILER_PATTERNS_H
 
 #include "markup/Pattern.h"
+#include "tokenizer/tokenStream.h"
 
 #include <vector>
 #include <iostream>
@@ -611,7 +612,7 @@ namespace markup
 		std::vector<Declaration> myDeclarations;
 	};
 
-	TranslationUnit Markup(const std::vector<tokenizer::Token>& aTokens);
+	TranslationUnit Markup(const tokenizer::TokenStream& aTokens);
 	
 	template<std::same_as<const tokenizer::Token*>... Types> 
 	std::string Tokens(std::string aSeparator, Types... aOthers)
@@ -0,0 +1,325 @@
+#include "precompiler/DependencyScanner.h"
+
+#include <atomic>
+#include <thread>
+#include <unordered_set>
+
+#include "common/CompilerContext.h"
+#include "precompiler/precompiler.h"
+#include "tokenizer/tokenizer.h"
+#include "tokenizer/tokenMatcher.h"
+#include "tools/fileHelpers.h"
+
+namespace dependency_scanner_internal
+{
+	bool IsIdentifierCharacter(char aCharacter)
+	{
+		return (aCharacter >= 'a' && aCharacter <= 'z') || (aCharacter >= 'A' && aCharacter <= 'Z') || (aCharacter >= '0' && aCharacter <= '9') || aCharacter == '_';
+	}
+
+	// Follows comments and literals across lines, a directive only starts on a line that does not begin inside a comment or a raw string
+	class DirectiveFinder
+	{
+	public:
+		bool StartsDirective(std::string_view aLine)
+		{
+			bool isDirective = false;
+			bool isFirst = true;
+			size_t wordEnd = std::string_view::npos;
+			std::string_view word;
+
+			size_t at = 0;
+			while (at < aLine.size())
+			{
+				if (myIsInComment)
+				{
+					size_t end = aLine.find("*/", at);
+					if (end == std::string_view::npos)
+						return isDirective;
+
+					myIsInComment = false;
+					at = end + 2;
+					continue;
+				}
+
+				if (!myRawStringEnd.empty())
+				{
+					size_t end = aLine.find(myRawStringEnd, at);
+					if (end == std::string_view::npos)
+						return isDirective;
+
+					at = end + myRawStringEnd.size();
+					myRawStringEnd.clear();
+					continue;
+				}
+
+				char c = aLine[at];
+				if (c == ' ' || c == '\t' || c == '\r')
+				{
+					at++;
+					continue;
+				}
+
+				if (aLine.substr(at, 2) == "//")
+					return isDirective;
+
+				if (aLine.substr(at, 2) == "/*")
+				{
+					myIsInComment = true;
+					at += 2;
+					continue;
+				}
+
+				if (isFirst && c == '#')
+					isDirective = true;
+				isFirst = false;
+
+				if (c >= '0' && c <= '9')
+				{
+					// pp-number, ' is a digit separator here
+					while (at < aLine.size() && (IsIdentifierCharacter(aLine[at]) || aLine[at] == '.' || aLine[at] == '\''))
+						at++;
+					continue;
+				}
+
+				if (IsIdentifierCharacter(c))
+				{
+					size_t start = at;
+					while (at < aLine.size() && IsIdentifierCharacter(aLine[at]))
+						at++;
+
+					word = aLine.substr(start, at - start);
+					wordEnd = at;
+					continue;
+				}
+
+				if (c == '"' && wordEnd == at && (word == "R" || word == "u8R" || word == "uR" || word == "UR" || word == "LR"))
+				{
+					size_t open = aLine.find('(', at);
+					if (open == std::string_view::npos)
+						return isDirective;
+
+					myRawStringEnd = ")" + std::string(aLine.substr(at + 1, open - at - 1)) + "\"";
+					at = open + 1;
+					continue;
+				}
+
+				if (c == '"' || c == '\'')
+				{
+					at++;
+					while (at < aLine.size() && aLine[at] != c)
+						at += aLine[at] == '\\' ? 2 : 1;
+
+					at++;
+					continue;
+				}
+
+				at++;
+			}
+
+			return isDirective;
+		}
+
+	private:
+		bool myIsInComment = false;
+		std::string myRawStringEnd;
+	};
+
+	void AppendMakeEscaped(std::string& aOut, const std::filesystem::path& aPath)
+	{
+		for (char c : aPath.generic_string())
+		{
+			if (c == ' ' || c == '#')
+				aOut += '\\';
+			else if (c == '$')
+				aOut += '$';
+			aOut += c;
+		}
+	}
+
+	void AppendJsonString(std::string& aOut, const std::filesystem::path& aPath)
+	{
+		aOut += '"';
+		for (char c : aPath.generic_string())
+		{
+			if (c == '"' || c == '\\')
+				aOut += '\\';
+			aOut += c;
+		}
+		aOut += '"';
+	}
+}
+
+std::vector<DependencyScanner::Dependencies> DependencyScanner::Scan(const std::vector<std::filesystem::path>& aFiles, const std::optional<std::filesystem::path>& aPrelude, const std::vector<std::string>& aConfigurations, size_t aThreadCount)
+{
+	std::vector<Dependencies> out(aFiles.size());
+	std::atomic<size_t> next = 0;
+
+	auto work = [&]()
+	{
+		for (size_t i = next++; i < aFiles.size(); i = next++)
+		{
+			if (aConfigurations.empty())
+			{
+				out[i] = ScanTranslationUnit(aFiles[i], aPrelude, {});
+				continue;
+			}
+
+			// a file any of the configurations includes is a dependency of the translation unit
+			std::unordered_set<std::string> seen;
+			for (const std::string& configuration : aConfigurations)
+			{
+				for (std::filesystem::path& dependency : ScanTranslationUnit(aFiles[i], aPrelude, configuration))
+				{
+					if (seen.insert(dependency.string()).second)
+						out[i].push_back(std::move(dependency));
+				}
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < std::min(aThreadCount, aFiles.size()); i++)
+		threads.emplace_back(work);
+
+	work();
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	return out;
+}
+
+std::string DependencyScanner::ToMake(const std::vector<std::filesystem::path>& aFiles, const std::vector<Dependencies>& aDependencies)
+{
+	using namespace dependency_scanner_internal;
+
+	std::string out;
+	for (size_t i = 0; i < aFiles.size(); i++)
+	{
+		AppendMakeEscaped(out, std::filesystem::path(aFiles[i]).replace_extension(".o"));
+		out += ':';
+
+		for (const std::filesystem::path& dependency : aDependencies[i])
+		{
+			out += " \\\n  ";
+			AppendMakeEscaped(out, dependency);
+		}
+		out += "\n";
+	}
+
+	return out;
+}
+
+std::string DependencyScanner::ToJson(const std::vector<std::filesystem::path>& aFiles, const std::vector<Dependencies>& aDependencies)
+{
+	using namespace dependency_scanner_internal;
+
+	std::string out = "[";
+	for (size_t i = 0; i < aFiles.size(); i++)
+	{
+		out += i == 0 ? "\n" : ",\n";
+		out += "\t{\n\t\t\"file\": ";
+		AppendJsonString(out, aFiles[i]);
+		out += ",\n\t\t\"dependencies\": [";
+
+		for (size_t j = 0; j < aDependencies[i].size(); j++)
+		{
+			out += j == 0 ? "\n\t\t\t" : ",\n\t\t\t";
+			AppendJsonString(out, aDependencies[i][j]);
+		}
+		out += "\n\t\t]\n\t}";
+	}
+	out += "\n]\n";
+
+	return out;
+}
+
+DependencyScanner::Dependencies DependencyScanner::ScanTranslationUnit(const std::filesystem::path& aFile, const std::optional<std::filesystem::path>& aPrelude, std::string_view aDefines)
+{
+	Precompiler::ResetContext();
+	Precompiler::Predefine(aDefines);
+	Precompiler::myContext->myScanner = this;
+
+	Dependencies out = { aFile };
+
+	if (aPrelude)
+	{
+		out.push_back(*aPrelude);
+
+		CompilerContext::PushFile(*aPrelude);
+		ScanFile(*aPrelude);
+		CompilerContext::PopFile();
+	}
+
+	CompilerContext::PushFile(aFile);
+	ScanFile(aFile);
+	CompilerContext::PopFile();
+
+	std::unordered_set<std::string> seen;
+	for (const std::filesystem::path& included : Precompiler::myContext->myIncludedFiles)
+	{
+		if (seen.insert(included.string()).second)
+			out.push_back(included);
+	}
+
+	Precompiler::ResetContext();
+	return out;
+}
+
+void DependencyScanner::ScanFile(const std::filesystem::path& aFile)
+{
+	std::shared_ptr<const DirectiveFile> directives = GetDirectives(aFile);
+
+	// only directive lines were kept, there is no source to print with diagnostics
+	CompilerContext::SetPrintContext({});
+
+	Precompiler::FileContext fileContext;
+	tokenizer::TokenStream discarded;
+	for (const DirectiveLine& directive : *directives)
+	{
+		CompilerContext::SetCurrentLine(directive.myLine);
+		Precompiler::ConsumeLine(fileContext, discarded, directive.myTokens);
+	}
+}
+
+std::shared_ptr<const DependencyScanner::DirectiveFile> DependencyScanner::GetDirectives(const std::filesystem::path& aFile)
+{
+	std::string key = std::filesystem::weakly_canonical(aFile).string();
+
+	{
+		std::lock_guard lock(myCacheMutex);
+		decltype(myCache)::iterator it = myCache.find(key);
+		if (it != std::end(myCache))
+			return it->second;
+	}
+
+	// reduced outside the lock, if two threads get here for the same file the first one to finish is kept
+	std::shared_ptr<const DirectiveFile> directives = std::make_shared<const DirectiveFile>(ReduceToDirectives(aFile));
+
+	std::lock_guard lock(myCacheMutex);
+	return myCache.try_emplace(key, std::move(directives)).first->second;
+}
+
+DependencyScanner::DirectiveFile DependencyScanner::ReduceToDirectives(const std::filesystem::path& aFile)
+{
+	std::vector<std::string> logicalSource = tokenizer::Reduce(ReadWholeFile(aFile));
+
+	DirectiveFile out;
+	dependency_scanner_internal::DirectiveFinder finder;
+	for (size_t i = 0; i < logicalSource.size(); i++)
+	{
+		if (!finder.StartsDirective(logicalSource[i]))
+			continue;
+
+		CompilerContext::SetCurrentLine(i);
+
+		DirectiveLine& directive = out.emplace_back();
+		directive.myLine = i;
+
+		tokenizer::TokenMatcher::Context tokenContext;
+		tokenizer::TokenMatcher::MatchTokens(directive.myTokens, logicalSource[i], tokenContext);
+	}
+
+	return out;
+}
@@ -0,0 +1,53 @@
+#ifndef PRECOMPILER_DEPENDENCY_SCANNER_H
+#define PRECOMPILER_DEPENDENCY_SCANNER_H
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "tokenizer/token.h"
+
+// Finds the files translation units include by running only their directive lines through the precompiler
+// The directive lines of a file are lexed once and shared by every translation unit and thread that includes it
+class DependencyScanner
+{
+public:
+	// The translation unit itself, the prelude if any, then every file any configuration included in the order they were first included
+	using Dependencies = std::vector<std::filesystem::path>;
+
+	// aPrelude is scanned in front of every file the same way -pch_header preprocesses it, the result for each file is at its index
+	// Every file is scanned once for each of aConfigurations, predefined the way -p:config does, or once without any if there are none
+	std::vector<Dependencies> Scan(const std::vector<std::filesystem::path>& aFiles, const std::optional<std::filesystem::path>& aPrelude, const std::vector<std::string>& aConfigurations, size_t aThreadCount);
+
+	static std::string ToMake(const std::vector<std::filesystem::path>& aFiles, const std::vector<Dependencies>& aDependencies);
+	static std::string ToJson(const std::vector<std::filesystem::path>& aFiles, const std::vector<Dependencies>& aDependencies);
+
+private:
+	friend class Precompiler;
+
+	struct DirectiveLine
+	{
+		size_t myLine;
+		std::vector<tokenizer::Token> myTokens;
+	};
+
+	using DirectiveFile = std::vector<DirectiveLine>;
+
+	Dependencies ScanTranslationUnit(const std::filesystem::path& aFile, const std::optional<std::filesystem::path>& aPrelude, std::string_view aDefines);
+
+	// Stands in for tokenizer::Tokenize, the file is expected to already be the current file
+	void ScanFile(const std::filesystem::path& aFile);
+
+	std::shared_ptr<const DirectiveFile> GetDirectives(const std::filesystem::path& aFile);
+	static DirectiveFile ReduceToDirectives(const std::filesystem::path& aFile);
+
+	std::mutex myCacheMutex;
+	std::unordered_map<std::string, std::shared_ptr<const DirectiveFile>> myCache;
+};
+
+#endif // PRECOMPILER_DEPENDENCY_SCANNER_H
@@ -0,0 +1,85 @@
+#include "precompiler/HideSet.h"
+
+#include <algorithm>
+#include <iterator>
+
+HideSets::HideSets()
+{
+	Intern({});
+}
+
+bool HideSets::Contains(Id aSet, size_t aMacro) const
+{
+	const std::vector<size_t>& members = mySets[aSet];
+	return std::binary_search(std::begin(members), std::end(members), aMacro);
+}
+
+HideSets::Id HideSets::Add(Id aSet, size_t aMacro)
+{
+	decltype(myAdditions)::iterator it = myAdditions.find({ aSet, aMacro });
+	if (it != std::end(myAdditions))
+		return it->second;
+
+	Id result = aSet;
+	if (!Contains(aSet, aMacro))
+	{
+		const std::vector<size_t>& members = mySets[aSet];
+		myScratch.assign(std::begin(members), std::end(members));
+		myScratch.insert(std::lower_bound(std::begin(myScratch), std::end(myScratch), aMacro), aMacro);
+
+		result = Intern(myScratch);
+	}
+
+	myAdditions.emplace(std::pair(aSet, aMacro), result);
+	return result;
+}
+
+HideSets::Id HideSets::Union(Id aLeft, Id aRight)
+{
+	if (aLeft == aRight || aRight == Empty)
+		return aLeft;
+	if (aLeft == Empty)
+		return aRight;
+
+	decltype(myUnions)::iterator it = myUnions.find({ aLeft, aRight });
+	if (it != std::end(myUnions))
+		return it->second;
+
+	myScratch.clear();
+	std::ranges::set_union(mySets[aLeft], mySets[aRight], std::back_inserter(myScratch));
+
+	Id result = Intern(myScratch);
+	myUnions.emplace(std::pair(aLeft, aRight), result);
+	return result;
+}
+
+HideSets::Id HideSets::Intersection(Id aLeft, Id aRight)
+{
+	if (aLeft == aRight)
+		return aLeft;
+	if (aLeft == Empty || aRight == Empty)
+		return Empty;
+
+	decltype(myIntersections)::iterator it = myIntersections.find({ aLeft, aRight });
+	if (it != std::end(myIntersections))
+		return it->second;
+
+	myScratch.clear();
+	std::ranges::set_intersection(mySets[aLeft], mySets[aRight], std::back_inserter(myScratch));
+
+	Id result = Intern(myScratch);
+	myIntersections.emplace(std::pair(aLeft, aRight), result);
+	return result;
+}
+
+HideSets::Id HideSets::Intern(const std::vector<size_t>& aMembers)
+{
+	decltype(myIds)::iterator it = myIds.find(aMembers);
+	if (it != std::end(myIds))
+		return it->second;
+
+	Id id = mySets.size();
+	mySets.push_back(aMembers);
+	myIds.emplace(aMembers, id);
+	return id;
+}
@@ -0,0 +1,40 @@
+#ifndef PRECOMPILER_HIDE_SET_H
+#define PRECOMPILER_HIDE_SET_H
+
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Interned sets of macro ids used to stop recursive macro expansion (Prosser's algorithm)
+// A set is referred to by a small id, the results of set operations are memoized so tokens can carry them around for free
+class HideSets
+{
+public:
+	using Id = size_t;
+
+	static constexpr Id Empty = 0;
+
+	HideSets();
+
+	bool Contains(Id aSet, size_t aMacro) const;
+	size_t Size(Id aSet) const { return mySets[aSet].size(); }
+
+	Id Add(Id aSet, size_t aMacro);
+	Id Union(Id aLeft, Id aRight);
+	Id Intersection(Id aLeft, Id aRight);
+
+private:
+	Id Intern(const std::vector<size_t>& aMembers);
+
+	std::vector<std::vector<size_t>> mySets;
+	std::map<std::vector<size_t>, Id> myIds;
+
+	std::map<std::pair<Id, size_t>, Id> myAdditions;
+	std::map<std::pair<Id, Id>, Id> myUnions;
+	std::map<std::pair<Id, Id>, Id> myIntersections;
+
+	std::vector<size_t> myScratch;
+};
+
+#endif // PRECOMPILER_HIDE_SET_H
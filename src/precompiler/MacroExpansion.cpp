@@ -0,0 +1,540 @@
+#include <algorithm>
+#include <iostream>
+
+#include "common/CompilerContext.h"
+#include "common/IncludeReport.h"
+#include "common/MacroStatistics.h"
+#include "common/TimeTrace.h"
+#include "common/Trace.h"
+#include "precompiler/precompiler.h"
+#include "tokenizer/tokenMatcher.h"
+
+namespace precompiler_internal_expansion
+{
+	// substitutions quicker than this are too many to keep in a -time_trace
+	const std::chrono::microseconds TraceMinimum(20);
+}
+
+bool Precompiler::Expand(ExpansionSpan aInput, std::vector<ExpansionToken>& aOut, bool aKeepDefinedOperands)
+{
+	ExpansionScratch& scratch = PushScratch();
+	bool ranOut = false;
+
+	// pending input is a stack of spans, the front of the last span is the next token, a macro replacement is pushed on top so it gets rescanned before the rest of the input
+	std::vector<ExpansionSpan>& pending = scratch.myPending;
+	pending.clear();
+	pending.push_back(aInput);
+
+	auto peek = [&pending]() -> const ExpansionToken*
+	{
+		while (!pending.empty() && pending.back().empty())
+			pending.pop_back();
+
+		if (pending.empty())
+			return nullptr;
+
+		return &pending.back().front();
+	};
+
+	auto next = [&pending, &peek]() -> const ExpansionToken*
+	{
+		const ExpansionToken* tok = peek();
+		if (tok)
+			pending.back() = pending.back().subspan(1);
+
+		return tok;
+	};
+
+	while (const ExpansionToken* tok = next())
+	{
+		if (aKeepDefinedOperands && tok->Spelling() == "defined")
+		{
+			// the operand of defined names a macro, it has to reach the evaluator unexpanded
+			aOut.push_back(*tok);
+
+			bool parenthesized = false;
+			while (const ExpansionToken* operand = next())
+			{
+				aOut.push_back(*operand);
+
+				if (!parenthesized && operand->Type() == tokenizer::Token::Type::L_Paren)
+				{
+					parenthesized = true;
+					continue;
+				}
+
+				if (!parenthesized || operand->Type() == tokenizer::Token::Type::R_Paren)
+					break;
+			}
+			continue;
+		}
+
+		Macro* macro = FindMacro(*tok);
+		if (!macro || myContext->myHideSets.Contains(tok->myHideSet, macro->myId))
+		{
+			aOut.push_back(*tok);
+			continue;
+		}
+
+		if (!macro->myIsFunctionLike)
+		{
+			IncludeReport::CountExpansion();
+			if (Trace::IsOn(CompilerContext::Verbose::Macros))
+				Trace::Line() << "expanding macro [" << macro->myIdentifier << "]";
+
+			// the macros a token came out of are in its hide set, this one is nested inside all of them
+			MacroStatistics::Invocation statistics(macro->myIdentifier, myContext->myHideSets.Size(tok->myHideSet) + 1);
+			TimeTrace::Span span("Macro", macro->myIdentifier, precompiler_internal_expansion::TraceMinimum);
+
+			// a name straight from the source always expands to the same thing, until something it looked at is redefined
+			if (tok->myHideSet == HideSets::Empty && !aKeepDefinedOperands)
+			{
+				if (!macro->myCachedExpansion)
+					FillCache(macro->myCachedExpansion.emplace(), *macro, {}, myContext->myHideSets.Add(HideSets::Empty, macro->myId), scratch, {});
+
+				if (macro->myCachedExpansion->myIsReusable)
+				{
+					statistics.Produced(macro->myCachedExpansion->mySubstitutedTokens);
+					AppendCached(*macro->myCachedExpansion, {}, aOut);
+					continue;
+				}
+			}
+
+			pending.push_back(Substitute(*macro, {}, myContext->myHideSets.Add(tok->myHideSet, macro->myId), scratch));
+			statistics.Produced(pending.back().size());
+			continue;
+		}
+
+		const ExpansionToken* open = peek();
+		if (!open || open->Type() != tokenizer::Token::Type::L_Paren)
+		{
+			// a function-like macro name without arguments is just a name
+			ranOut |= !open;
+			aOut.push_back(*tok);
+			continue;
+		}
+		next();
+
+		scratch.myArgumentTokens.clear();
+		scratch.myArgumentBounds.clear();
+		scratch.myArgumentBounds.push_back(0);
+
+		const ExpansionToken* close = nullptr;
+		size_t depth = 0;
+		while (const ExpansionToken* argTok = next())
+		{
+			tokenizer::Token::Type type = argTok->Type();
+			if (type == tokenizer::Token::Type::R_Paren && depth == 0)
+			{
+				close = argTok;
+				break;
+			}
+
+			if (type == tokenizer::Token::Type::L_Paren)
+				depth++;
+			if (type == tokenizer::Token::Type::R_Paren)
+				depth--;
+
+			// the trailing commas all belong to the variadic argument
+			if (type == tokenizer::Token::Type::Comma && depth == 0 && (!macro->myHasVariadic || scratch.myArgumentBounds.size() <= macro->myArguments))
+			{
+				scratch.myArgumentBounds.push_back(scratch.myArgumentTokens.size());
+				continue;
+			}
+
+			scratch.myArgumentTokens.push_back(*argTok);
+		}
+
+		if (!close)
+		{
+			ranOut = true;
+			EmitExpansionError("Unterminated argument list for macro " + macro->myIdentifier, *tok->myToken);
+			continue;
+		}
+
+		size_t given = scratch.myArgumentBounds.size();
+		if (given == 1 && scratch.myArgumentTokens.empty() && macro->myArguments == 0 && !macro->myHasVariadic)
+			given = 0;
+
+		if (given < macro->myArguments)
+		{
+			EmitExpansionError("Expected more arguments for macro " + macro->myIdentifier, *close->myToken);
+			continue;
+		}
+
+		if (given > macro->myArguments && !macro->myHasVariadic)
+		{
+			EmitExpansionError("Too many arguments for macro " + macro->myIdentifier, *close->myToken);
+			continue;
+		}
+
+		std::span<const ExpansionToken> argumentTokens = myContext->myArena.Copy(scratch.myArgumentTokens);
+
+		scratch.myArguments.clear();
+		scratch.myArgumentBounds.push_back(argumentTokens.size());
+		for (size_t i = 0; i < given; i++)
+			scratch.myArguments.push_back(argumentTokens.subspan(scratch.myArgumentBounds[i], scratch.myArgumentBounds[i + 1] - scratch.myArgumentBounds[i]));
+
+		IncludeReport::CountExpansion();
+		if (Trace::IsOn(CompilerContext::Verbose::Macros))
+			Trace::Line() << "expanding macro [" << macro->myIdentifier << "] with " << given << " arguments";
+
+		MacroStatistics::Invocation statistics(macro->myIdentifier, myContext->myHideSets.Size(tok->myHideSet) + 1);
+		TimeTrace::Span span("Macro", macro->myIdentifier, precompiler_internal_expansion::TraceMinimum);
+
+		HideSets::Id hideSet = myContext->myHideSets.Intersection(tok->myHideSet, close->myHideSet);
+
+		bool fromSource = hideSet == HideSets::Empty && std::ranges::all_of(argumentTokens, [](const ExpansionToken& aToken) { return aToken.myHideSet == HideSets::Empty; });
+		if (fromSource && !aKeepDefinedOperands && CompilerContext::GetSwitches().myMacroCache)
+		{
+			// invocations are told apart by the spelling of their arguments
+			std::string& key = scratch.myInvocationKey;
+			key.clear();
+			for (const ExpansionSpan& argument : scratch.myArguments)
+			{
+				for (const ExpansionToken& argTok : argument)
+				{
+					key += argTok.Spelling();
+					key += '\0';
+				}
+				key += '\1';
+			}
+
+			decltype(Macro::myCachedInvocations)::iterator cached = macro->myCachedInvocations.find(key);
+			if (cached == std::end(macro->myCachedInvocations))
+			{
+				cached = macro->myCachedInvocations.emplace(key, CachedExpansion()).first;
+
+				// filling the cache can add more invocations of this macro, the entry itself stays put
+				CachedExpansion& entry = cached->second;
+				FillCache(entry, *macro, scratch.myArguments, myContext->myHideSets.Add(hideSet, macro->myId), scratch, argumentTokens);
+
+				if (entry.myIsReusable)
+				{
+					statistics.Produced(entry.mySubstitutedTokens);
+					AppendCached(entry, argumentTokens, aOut);
+					continue;
+				}
+			}
+			else if (cached->second.myIsReusable)
+			{
+				statistics.Produced(cached->second.mySubstitutedTokens);
+				AppendCached(cached->second, argumentTokens, aOut);
+				continue;
+			}
+		}
+
+		pending.push_back(Substitute(*macro, scratch.myArguments, myContext->myHideSets.Add(hideSet, macro->myId), scratch));
+		statistics.Produced(pending.back().size());
+	}
+
+	PopScratch();
+	return ranOut;
+}
+
+Precompiler::ExpansionSpan Precompiler::Substitute(const Macro& aMacro, std::span<const ExpansionSpan> aArguments, HideSets::Id aHideSet, ExpansionScratch& aScratch)
+{
+	aScratch.myExpandedArguments.assign(aArguments.size(), std::nullopt);
+	aScratch.mySubstitution.clear();
+
+	// the variadic arguments are the last argument, if they were given at all
+	auto argument = [&](size_t aIndex) -> ExpansionSpan
+	{
+		return aIndex < aArguments.size() ? aArguments[aIndex] : ExpansionSpan();
+	};
+
+	auto expandedArgument = [&](size_t aIndex) -> ExpansionSpan
+	{
+		if (aIndex >= aArguments.size())
+			return {};
+
+		std::optional<ExpansionSpan>& expanded = aScratch.myExpandedArguments[aIndex];
+		if (!expanded)
+		{
+			// arguments are fully expanded on their own before being substituted, and only once no matter how often they are used
+			aScratch.myExpandedArgument.clear();
+			Expand(aArguments[aIndex], aScratch.myExpandedArgument, false);
+			expanded = myContext->myArena.Copy(aScratch.myExpandedArgument);
+		}
+
+		return *expanded;
+	};
+
+	auto isPasteOperand = [&aMacro](size_t aComponent)
+	{
+		const std::vector<Macro::Component>& components = aMacro.myComponents;
+		return (aComponent > 0 && components[aComponent - 1].myType == Macro::Component::Type::Paste)
+			|| (aComponent + 1 < components.size() && components[aComponent + 1].myType == Macro::Component::Type::Paste);
+	};
+
+	std::vector<ExpansionToken>& out = aScratch.mySubstitution;
+
+	size_t operandStart = 0;
+	size_t pasteLeftStart = 0;
+	const tokenizer::Token* pasteLocation = nullptr;
+
+	for (size_t i = 0; i < aMacro.myComponents.size(); i++)
+	{
+		const Macro::Component& comp = aMacro.myComponents[i];
+		size_t start = out.size();
+
+		switch (comp.myType)
+		{
+		case Macro::Component::Type::Token:
+			out.push_back({ &*comp.myToken, comp.myToken->myRawText, comp.myToken->myType, aHideSet, comp.myHasLeadingSpace });
+			break;
+		case Macro::Component::Type::Argument:
+		case Macro::Component::Type::VariadicExpansion:
+			{
+				size_t index = comp.myType == Macro::Component::Type::Argument ? comp.myArgumentIndex : aMacro.myArguments;
+
+				// operands of ## are pasted as written, not expanded
+				for (const ExpansionToken& tok : isPasteOperand(i) ? argument(index) : expandedArgument(index))
+				{
+					out.push_back(tok);
+					out.back().myHideSet = myContext->myHideSets.Union(tok.myHideSet, aHideSet);
+				}
+
+				if (out.size() > start)
+					out[start].myHasLeadingSpace = comp.myHasLeadingSpace;
+			}
+			break;
+		case Macro::Component::Type::Stringify:
+			out.push_back(Stringify(*comp.myToken, argument(comp.myArgumentIndex)));
+			out.back().myHideSet = aHideSet;
+			out.back().myHasLeadingSpace = comp.myHasLeadingSpace;
+			break;
+		case Macro::Component::Type::Paste:
+			pasteLocation = &*comp.myToken;
+			pasteLeftStart = operandStart;
+			continue;
+		}
+
+		if (!pasteLocation)
+		{
+			operandStart = start;
+			continue;
+		}
+
+		// an empty operand is a placemarker, pasting with it leaves the other operand as is
+		if (start > pasteLeftStart && out.size() > start)
+		{
+			if (std::optional<ExpansionToken> pasted = Paste(*pasteLocation, out[start - 1], out[start]))
+			{
+				out[start - 1] = *pasted;
+				out.erase(out.begin() + start);
+			}
+		}
+
+		operandStart = pasteLeftStart;
+		pasteLocation = nullptr;
+	}
+
+	return myContext->myArena.Copy(out);
+}
+
+Precompiler::Macro* Precompiler::FindMacro(const ExpansionToken& aToken)
+{
+	tokenizer::Token::Type type = aToken.Type();
+	if (type != tokenizer::Token::Type::Identifier && (type < tokenizer::Token::Type::kw_alignas || type > tokenizer::Token::Type::kw_while))
+		return nullptr;
+
+	if (myContext->myRecording > 0)
+		myContext->myDependencies.push_back(aToken.Spelling());
+
+	decltype(Context::myMacros)::iterator it = myContext->myMacros.find(aToken.Spelling());
+	if (it == std::end(myContext->myMacros))
+		return nullptr;
+
+	return &it->second;
+}
+
+Precompiler::ExpansionToken Precompiler::Stringify(const tokenizer::Token& aLocation, ExpansionSpan aArgument)
+{
+	auto needsEscape = [](const ExpansionToken& aToken)
+	{
+		return aToken.Type() == tokenizer::Token::Type::String_literal || aToken.Type() == tokenizer::Token::Type::Char_literal;
+	};
+
+	size_t length = 2;
+	for (size_t i = 0; i < aArgument.size(); i++)
+	{
+		const ExpansionToken& tok = aArgument[i];
+		if (i != 0 && tok.myHasLeadingSpace)
+			length++;
+
+		length += tok.Spelling().length();
+		if (needsEscape(tok))
+			length += std::ranges::count_if(tok.Spelling(), [](char aChar) { return aChar == '"' || aChar == '\\'; });
+	}
+
+	// measured first so the spelling is written straight into the arena
+	std::span<char> spelling = myContext->mySpellings.Allocate(length);
+	std::span<char>::iterator write = spelling.begin();
+
+	*write++ = '"';
+	for (size_t i = 0; i < aArgument.size(); i++)
+	{
+		const ExpansionToken& tok = aArgument[i];
+		if (i != 0 && tok.myHasLeadingSpace)
+			*write++ = ' ';
+
+		bool escape = needsEscape(tok);
+		for (char c : tok.Spelling())
+		{
+			if (escape && (c == '"' || c == '\\'))
+				*write++ = '\\';
+			*write++ = c;
+		}
+	}
+	*write++ = '"';
+
+	return { &aLocation, std::string_view(spelling.data(), spelling.size()), tokenizer::Token::Type::String_literal };
+}
+
+std::optional<Precompiler::ExpansionToken> Precompiler::Paste(const tokenizer::Token& aLocation, const ExpansionToken& aLeft, const ExpansionToken& aRight)
+{
+	std::span<char> spelling = myContext->mySpellings.Allocate(aLeft.Spelling().length() + aRight.Spelling().length());
+	std::ranges::copy(aRight.Spelling(), std::ranges::copy(aLeft.Spelling(), spelling.begin()).out);
+
+	std::string_view text(spelling.data(), spelling.size());
+
+	std::optional<tokenizer::Token::Type> type = tokenizer::TokenMatcher::MatchSingle(text);
+	if (!type)
+	{
+		EmitExpansionError("Pasting \"" + std::string(aLeft.Spelling()) + "\" and \"" + std::string(aRight.Spelling()) + "\" does not give a valid preprocessing token", aLocation);
+		return {};
+	}
+
+	return ExpansionToken{ &aLocation, text, *type, myContext->myHideSets.Union(aLeft.myHideSet, aRight.myHideSet), aLeft.myHasLeadingSpace };
+}
+
+bool Precompiler::HasLeadingSpace(const tokenizer::Token& aPrevious, const tokenizer::Token& aToken)
+{
+	return aToken.myLine != aPrevious.myLine || aToken.myColumn != aPrevious.myColumn + aPrevious.myRawText.length();
+}
+
+void Precompiler::EmitExpansionError(const std::string& aMessage, const tokenizer::Token& aToken)
+{
+	myContext->myExpansionErrors++;
+	CompilerContext::EmitError(aMessage, aToken);
+}
+
+void Precompiler::FillCache(CachedExpansion& aOutEntry, const Macro& aMacro, std::span<const ExpansionSpan> aArguments, HideSets::Id aHideSet, ExpansionScratch& aScratch, ExpansionSpan aArgumentTokens)
+{
+	size_t errors = myContext->myExpansionErrors;
+	size_t dependencies = myContext->myDependencies.size();
+
+	bool ranOut;
+	{
+		// the expansion is done on its own, whatever went wrong is reported again when it is redone in place
+		CompilerContext::IgnoreHandle ignore = CompilerContext::IgnoreErrors();
+
+		// substituting expands the arguments, the macros they look up are as much a part of the entry as the ones in the body
+		myContext->myRecording++;
+		ExpansionSpan substitution = Substitute(aMacro, aArguments, aHideSet, aScratch);
+		aOutEntry.mySubstitutedTokens = substitution.size();
+		ranOut = Expand(substitution, aOutEntry.myTokens, false);
+		myContext->myRecording--;
+	}
+
+	// whatever the outcome, the entry is stale once something it looked at changes
+	std::vector<std::string_view> looked(myContext->myDependencies.begin() + dependencies, myContext->myDependencies.end());
+	std::ranges::sort(looked);
+	looked.erase(std::ranges::unique(looked).begin(), std::end(looked));
+	aOutEntry.myDependencies.assign(std::begin(looked), std::end(looked));
+
+	for (const std::string& dependency : aOutEntry.myDependencies)
+	{
+		std::vector<std::string>& dependents = myContext->myCacheDependents[dependency];
+		if (dependents.empty() || dependents.back() != aMacro.myIdentifier)
+			dependents.push_back(aMacro.myIdentifier);
+	}
+
+	// an enclosing cache fill depends on everything this one did
+	if (myContext->myRecording == 0)
+		myContext->myDependencies.resize(dependencies);
+
+	aOutEntry.myIsReusable = !ranOut && errors == myContext->myExpansionErrors;
+	if (!aOutEntry.myIsReusable)
+	{
+		aOutEntry.myTokens.clear();
+		return;
+	}
+
+	// move everything that only lives as long as the current line into the entry
+	size_t spellingLength = 0;
+	for (const ExpansionToken& tok : aOutEntry.myTokens)
+	{
+		if (tok.IsSynthesized())
+			spellingLength += tok.Spelling().length();
+	}
+	aOutEntry.mySpellings.reserve(spellingLength);
+
+	aOutEntry.myArgumentTokens.assign(aOutEntry.myTokens.size(), std::string::npos);
+	for (size_t i = 0; i < aOutEntry.myTokens.size(); i++)
+	{
+		ExpansionToken& tok = aOutEntry.myTokens[i];
+		if (tok.IsSynthesized())
+		{
+			size_t offset = aOutEntry.mySpellings.size();
+			aOutEntry.mySpellings += tok.Spelling();
+			tok.mySpelling = std::string_view(aOutEntry.mySpellings).substr(offset, tok.Spelling().length());
+			continue;
+		}
+
+		ExpansionSpan::iterator argument = std::ranges::find(aArgumentTokens, tok.myToken, &ExpansionToken::myToken);
+		if (argument != std::end(aArgumentTokens))
+			aOutEntry.myArgumentTokens[i] = argument - std::begin(aArgumentTokens);
+	}
+}
+
+void Precompiler::AppendCached(const CachedExpansion& aEntry, ExpansionSpan aArgumentTokens, std::vector<ExpansionToken>& aOut)
+{
+	if (myContext->myRecording > 0)
+		myContext->myDependencies.insert(std::end(myContext->myDependencies), std::begin(aEntry.myDependencies), std::end(aEntry.myDependencies));
+
+	for (size_t i = 0; i < aEntry.myTokens.size(); i++)
+	{
+		aOut.push_back(aEntry.myTokens[i]);
+
+		size_t argument = aEntry.myArgumentTokens[i];
+		if (argument != std::string::npos)
+		{
+			aOut.back().myToken = aArgumentTokens[argument].myToken;
+			aOut.back().mySpelling = aArgumentTokens[argument].mySpelling;
+		}
+	}
+}
+
+void Precompiler::InvalidateCachesUsing(std::string_view aMacro)
+{
+	decltype(Context::myCacheDependents)::iterator it = myContext->myCacheDependents.find(aMacro);
+	if (it == std::end(myContext->myCacheDependents))
+		return;
+
+	for (const std::string& dependent : it->second)
+	{
+		decltype(Context::myMacros)::iterator macro = myContext->myMacros.find(dependent);
+		if (macro == std::end(myContext->myMacros))
+			continue;
+
+		macro->second.myCachedExpansion.reset();
+		macro->second.myCachedInvocations.clear();
+	}
+
+	myContext->myCacheDependents.erase(it);
+}
+
+Precompiler::ExpansionScratch& Precompiler::PushScratch()
+{
+	if (myContext->myScratch.size() <= myContext->myDepth)
+		myContext->myScratch.emplace_back();
+
+	return myContext->myScratch[myContext->myDepth++];
+}
+
+void Precompiler::PopScratch()
+{
+	myContext->myDepth--;
+}
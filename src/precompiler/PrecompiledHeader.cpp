@@ -0,0 +1,417 @@
+#include "precompiler/PrecompiledHeader.h"
+
+#include <cstring>
+#include <fstream>
+#include <map>
+
+#include "common/CompilerContext.h"
+#include "precompiler/precompiler.h"
+
+struct PrecompiledHeader::StringRecord
+{
+	uint32_t myOffset;
+	uint32_t myLength;
+};
+
+struct PrecompiledHeader::Header
+{
+	char myMagic[4];
+	uint32_t myVersion;
+	uint64_t myMacroCounter;
+	StringRecord myPrelude;
+	StringRecord myDefines;
+
+	uint64_t myStringsOffset;
+	uint64_t myStringsSize;
+	uint64_t myFilesOffset;
+	uint64_t myFileCount;
+	uint64_t myDependenciesOffset;
+	uint64_t myDependencyCount;
+	uint64_t myTokensOffset;
+	uint64_t myTokenCount;
+	uint64_t myMacrosOffset;
+	uint64_t myMacroCount;
+	uint64_t myComponentsOffset;
+	uint64_t myComponentCount;
+	uint64_t myOnceOffset;
+	uint64_t myOnceCount;
+};
+
+struct PrecompiledHeader::FileRecord
+{
+	StringRecord myPath;
+};
+
+struct PrecompiledHeader::DependencyRecord
+{
+	uint32_t myFile;
+	uint32_t myPadding;
+	uint64_t mySize;
+	int64_t myModified;
+};
+
+struct PrecompiledHeader::TokenRecord
+{
+	uint32_t myType;
+	uint32_t myFile;
+	StringRecord myText;
+	uint64_t myLine;
+	uint64_t myColumn;
+};
+
+struct PrecompiledHeader::MacroRecord
+{
+	static constexpr uint32_t FunctionLike = 1;
+	static constexpr uint32_t Variadic = 2;
+
+	StringRecord myIdentifier;
+	uint64_t myId;
+	uint32_t myArguments;
+	uint32_t myFlags;
+	uint32_t myFirstComponent;
+	uint32_t myComponentCount;
+};
+
+struct PrecompiledHeader::ComponentRecord
+{
+	static constexpr uint32_t HasToken = 1;
+	static constexpr uint32_t LeadingSpace = 2;
+
+	uint32_t myType;
+	uint32_t myFlags;
+	uint64_t myArgumentIndex;
+	TokenRecord myToken;
+};
+
+namespace precompiled_header_internal
+{
+	constexpr char ourMagic[4] = { 'F', 'P', 'C', 'H' };
+
+	int64_t ModificationTime(const std::filesystem::path& aPath, std::error_code& aError)
+	{
+		return static_cast<int64_t>(std::filesystem::last_write_time(aPath, aError).time_since_epoch().count());
+	}
+}
+
+bool PrecompiledHeader::Write(const std::filesystem::path& aSnapshotPath, const std::filesystem::path& aPrelude, std::string_view aDefines, const std::vector<tokenizer::Token>& aTokens)
+{
+	const Precompiler::Context& context = *Precompiler::myContext;
+
+	std::string strings;
+	std::map<std::filesystem::path, uint32_t> fileIndices;
+	std::vector<FileRecord> files;
+	std::vector<DependencyRecord> dependencies;
+	std::vector<TokenRecord> tokens;
+	std::vector<MacroRecord> macros;
+	std::vector<ComponentRecord> components;
+	std::vector<uint32_t> once;
+
+	auto addString = [&strings](std::string_view aText) -> StringRecord
+	{
+		StringRecord record{ static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(aText.size()) };
+		strings += aText;
+		return record;
+	};
+
+	auto addFile = [&](const std::filesystem::path& aPath) -> uint32_t
+	{
+		auto [it, inserted] = fileIndices.try_emplace(aPath, static_cast<uint32_t>(files.size()));
+		if (inserted)
+			files.push_back({ addString(aPath.generic_string()) });
+
+		return it->second;
+	};
+
+	auto makeToken = [&](const tokenizer::Token& aToken) -> TokenRecord
+	{
+		return { static_cast<uint32_t>(aToken.myType), addFile(aToken.myFile), addString(aToken.myRawText), aToken.myLine, aToken.myColumn };
+	};
+
+	std::vector<std::filesystem::path> read = context.myIncludedFiles;
+	read.push_back(std::filesystem::weakly_canonical(aPrelude));
+	std::ranges::sort(read);
+	read.erase(std::ranges::unique(read).begin(), std::end(read));
+
+	for (const std::filesystem::path& path : read)
+	{
+		std::error_code error;
+		uint64_t size = std::filesystem::file_size(path, error);
+		int64_t modified = precompiled_header_internal::ModificationTime(path, error);
+		if (error)
+		{
+			CompilerContext::EmitError("Unable to stat " + path.string() + " for the precompiled header: " + error.message(), aSnapshotPath);
+			return false;
+		}
+
+		dependencies.push_back({ addFile(path), 0, size, modified });
+	}
+
+	tokens.reserve(aTokens.size());
+	for (const tokenizer::Token& tok : aTokens)
+		tokens.push_back(makeToken(tok));
+
+	for (const auto& [identifier, macro] : context.myMacros)
+	{
+		MacroRecord record{};
+		record.myIdentifier = addString(identifier);
+		record.myId = macro.myId;
+		record.myArguments = static_cast<uint32_t>(macro.myArguments);
+		record.myFlags = (macro.myIsFunctionLike ? MacroRecord::FunctionLike : 0u) | (macro.myHasVariadic ? MacroRecord::Variadic : 0u);
+		record.myFirstComponent = static_cast<uint32_t>(components.size());
+		record.myComponentCount = static_cast<uint32_t>(macro.myComponents.size());
+		macros.push_back(record);
+
+		for (const Precompiler::Macro::Component& comp : macro.myComponents)
+		{
+			ComponentRecord component{};
+			component.myType = static_cast<uint32_t>(comp.myType);
+			component.myFlags = (comp.myToken ? ComponentRecord::HasToken : 0u) | (comp.myHasLeadingSpace ? ComponentRecord::LeadingSpace : 0u);
+			if (comp.myType == Precompiler::Macro::Component::Type::Argument || comp.myType == Precompiler::Macro::Component::Type::Stringify)
+				component.myArgumentIndex = comp.myArgumentIndex;
+			if (comp.myToken)
+				component.myToken = makeToken(*comp.myToken);
+			components.push_back(component);
+		}
+	}
+
+	for (const std::filesystem::path& path : context.myOnceFiles)
+		once.push_back(addFile(path));
+
+	Header header{};
+	std::memcpy(header.myMagic, precompiled_header_internal::ourMagic, sizeof(header.myMagic));
+	header.myVersion = ourVersion;
+	header.myMacroCounter = context.myMacroCounter;
+	header.myPrelude = addString(aPrelude.generic_string());
+	header.myDefines = addString(aDefines);
+
+	// sections are laid out after the header, each one aligned so the records can be used in place
+	std::string out(sizeof(Header), '\0');
+	auto appendSection = [&out](const void* aData, size_t aSize, uint64_t& aOutOffset)
+	{
+		out.resize((out.size() + 7) & ~size_t(7), '\0');
+		aOutOffset = out.size();
+		out.append(static_cast<const char*>(aData), aSize);
+	};
+
+	appendSection(files.data(), files.size() * sizeof(FileRecord), header.myFilesOffset);
+	appendSection(dependencies.data(), dependencies.size() * sizeof(DependencyRecord), header.myDependenciesOffset);
+	appendSection(tokens.data(), tokens.size() * sizeof(TokenRecord), header.myTokensOffset);
+	appendSection(macros.data(), macros.size() * sizeof(MacroRecord), header.myMacrosOffset);
+	appendSection(components.data(), components.size() * sizeof(ComponentRecord), header.myComponentsOffset);
+	appendSection(once.data(), once.size() * sizeof(uint32_t), header.myOnceOffset);
+	appendSection(strings.data(), strings.size(), header.myStringsOffset);
+
+	header.myFileCount = files.size();
+	header.myDependencyCount = dependencies.size();
+	header.myTokenCount = tokens.size();
+	header.myMacroCount = macros.size();
+	header.myComponentCount = components.size();
+	header.myOnceCount = once.size();
+	header.myStringsSize = strings.size();
+	std::memcpy(out.data(), &header, sizeof(Header));
+
+	// written next to the target and moved over it so a reader never maps a half written snapshot
+	std::filesystem::path temporary = aSnapshotPath;
+	temporary += ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file || !file.write(out.data(), out.size()))
+		{
+			CompilerContext::EmitError("Failed to write precompiled header", aSnapshotPath);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, aSnapshotPath, error);
+	if (error)
+	{
+		CompilerContext::EmitError("Failed to write precompiled header: " + error.message(), aSnapshotPath);
+		return false;
+	}
+
+	return true;
+}
+
+PrecompiledHeader::PrecompiledHeader(const std::filesystem::path& aSnapshotPath, std::string_view aDefines)
+	: myFile(aSnapshotPath)
+{
+	std::span<const char> data = myFile.Get();
+	if (data.size() < sizeof(Header) || std::memcmp(data.data(), precompiled_header_internal::ourMagic, sizeof(precompiled_header_internal::ourMagic)) != 0)
+	{
+		myProblem = "not a precompiled header";
+		return;
+	}
+
+	myHeader = reinterpret_cast<const Header*>(data.data());
+	if (myHeader->myVersion != ourVersion)
+	{
+		myProblem = "made by a different version of the compiler";
+		return;
+	}
+
+	std::optional<std::span<const char>> strings = Section<char>(myHeader->myStringsOffset, myHeader->myStringsSize);
+	std::optional<std::span<const FileRecord>> files = Section<FileRecord>(myHeader->myFilesOffset, myHeader->myFileCount);
+	std::optional<std::span<const DependencyRecord>> dependencies = Section<DependencyRecord>(myHeader->myDependenciesOffset, myHeader->myDependencyCount);
+
+	std::optional<std::span<const MacroRecord>> macros = Section<MacroRecord>(myHeader->myMacrosOffset, myHeader->myMacroCount);
+
+	if (!strings || !files || !dependencies || !macros
+		|| !Section<TokenRecord>(myHeader->myTokensOffset, myHeader->myTokenCount)
+		|| !Section<ComponentRecord>(myHeader->myComponentsOffset, myHeader->myComponentCount)
+		|| !Section<uint32_t>(myHeader->myOnceOffset, myHeader->myOnceCount))
+	{
+		myProblem = "truncated";
+		return;
+	}
+
+	for (const MacroRecord& macro : *macros)
+	{
+		if (macro.myFirstComponent > myHeader->myComponentCount || macro.myComponentCount > myHeader->myComponentCount - macro.myFirstComponent)
+		{
+			myProblem = "corrupt";
+			return;
+		}
+	}
+
+	myStrings = std::string_view(strings->data(), strings->size());
+	myPrelude = std::filesystem::path(String(myHeader->myPrelude));
+	myDefines = String(myHeader->myDefines);
+
+	myFiles.reserve(files->size());
+	for (const FileRecord& file : *files)
+		myFiles.emplace_back(String(file.myPath));
+
+	for (const DependencyRecord& dependency : *dependencies)
+	{
+		if (dependency.myFile >= myFiles.size())
+		{
+			myProblem = "corrupt";
+			return;
+		}
+	}
+
+	if (std::optional<std::filesystem::path> changed = FindChangedDependency())
+	{
+		myProblem = changed->string() + " has changed since it was made";
+		return;
+	}
+
+	// the prelude can test anything that was predefined, the snapshot only holds what it came to with these
+	if (myDefines != aDefines)
+	{
+		myProblem = "made with the defines [" + myDefines + "], not [" + std::string(aDefines) + "]";
+		return;
+	}
+}
+
+bool PrecompiledHeader::HasChanged() const
+{
+	return myProblem.empty() && FindChangedDependency();
+}
+
+std::optional<std::filesystem::path> PrecompiledHeader::FindChangedDependency() const
+{
+	std::span<const DependencyRecord> dependencies = *Section<DependencyRecord>(myHeader->myDependenciesOffset, myHeader->myDependencyCount);
+	for (const DependencyRecord& dependency : dependencies)
+	{
+		const std::filesystem::path& path = myFiles[dependency.myFile];
+
+		std::error_code error;
+		uint64_t size = std::filesystem::file_size(path, error);
+		int64_t modified = precompiled_header_internal::ModificationTime(path, error);
+		if (error || size != dependency.mySize || modified != dependency.myModified)
+			return path;
+	}
+
+	return {};
+}
+
+void PrecompiledHeader::Apply() const
+{
+	Precompiler::ResetContext();
+	Precompiler::Context& context = *Precompiler::myContext;
+
+	std::span<const MacroRecord> macros = *Section<MacroRecord>(myHeader->myMacrosOffset, myHeader->myMacroCount);
+	std::span<const ComponentRecord> components = *Section<ComponentRecord>(myHeader->myComponentsOffset, myHeader->myComponentCount);
+	std::span<const uint32_t> once = *Section<uint32_t>(myHeader->myOnceOffset, myHeader->myOnceCount);
+	std::span<const DependencyRecord> dependencies = *Section<DependencyRecord>(myHeader->myDependenciesOffset, myHeader->myDependencyCount);
+
+	context.myMacroCounter = myHeader->myMacroCounter;
+
+	for (const MacroRecord& record : macros)
+	{
+		Precompiler::Macro macro;
+		macro.myIdentifier = String(record.myIdentifier);
+		macro.myId = record.myId;
+		macro.myArguments = record.myArguments;
+		macro.myIsFunctionLike = record.myFlags & MacroRecord::FunctionLike;
+		macro.myHasVariadic = record.myFlags & MacroRecord::Variadic;
+
+		std::span<const ComponentRecord> body = components.subspan(record.myFirstComponent, record.myComponentCount);
+		macro.myComponents.reserve(body.size());
+		for (const ComponentRecord& component : body)
+		{
+			Precompiler::Macro::Component comp;
+			comp.myType = static_cast<Precompiler::Macro::Component::Type>(component.myType);
+			comp.myArgumentIndex = component.myArgumentIndex;
+			comp.myHasLeadingSpace = component.myFlags & ComponentRecord::LeadingSpace;
+			if (component.myFlags & ComponentRecord::HasToken)
+				comp.myToken = MakeToken(component.myToken);
+
+			macro.myComponents.push_back(std::move(comp));
+		}
+
+		std::string identifier = macro.myIdentifier;
+		context.myMacros.insert_or_assign(std::move(identifier), std::move(macro));
+	}
+
+	for (uint32_t file : once)
+	{
+		if (file < myFiles.size())
+			context.myOnceFiles.insert(myFiles[file]);
+	}
+
+	for (const DependencyRecord& dependency : dependencies)
+		context.myIncludedFiles.push_back(myFiles[dependency.myFile]);
+
+}
+
+std::vector<tokenizer::Token> PrecompiledHeader::GetTokens() const
+{
+	std::span<const TokenRecord> tokens = *Section<TokenRecord>(myHeader->myTokensOffset, myHeader->myTokenCount);
+
+	std::vector<tokenizer::Token> out;
+	out.reserve(tokens.size());
+	for (const TokenRecord& record : tokens)
+		out.push_back(MakeToken(record));
+
+	return out;
+}
+
+template<class Record>
+std::optional<std::span<const Record>> PrecompiledHeader::Section(uint64_t aOffset, uint64_t aCount) const
+{
+	std::span<const char> data = myFile.Get();
+	if (aOffset % alignof(Record) != 0 || aOffset > data.size() || aCount > (data.size() - aOffset) / sizeof(Record))
+		return {};
+
+	return std::span<const Record>(reinterpret_cast<const Record*>(data.data() + aOffset), aCount);
+}
+
+std::string_view PrecompiledHeader::String(const StringRecord& aString) const
+{
+	if (aString.myOffset > myStrings.size())
+		return {};
+
+	return myStrings.substr(aString.myOffset, aString.myLength);
+}
+
+tokenizer::Token PrecompiledHeader::MakeToken(const TokenRecord& aToken) const
+{
+	tokenizer::Token tok(static_cast<tokenizer::Token::Type>(aToken.myType), String(aToken.myText), aToken.myLine, aToken.myColumn);
+	if (aToken.myFile < myFiles.size())
+		tok.myFile = myFiles[aToken.myFile];
+
+	return tok;
+}
@@ -0,0 +1,72 @@
+#ifndef PRECOMPILER_PRECOMPILED_HEADER_H
+#define PRECOMPILER_PRECOMPILED_HEADER_H
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "tokenizer/token.h"
+#include "tools/MappedFile.h"
+
+// Snapshot of the preprocessor after a prelude header: the macro table, the #pragma once set and the tokens the prelude produced
+// The file is plain records in native layout so it can be used straight from the mapping, it is only trusted while every file
+// the prelude read still has the size and modification time it had when the snapshot was written
+class PrecompiledHeader
+{
+public:
+	// aDefines are what was predefined before the prelude, as given to Precompiler::Predefine
+	static bool Write(const std::filesystem::path& aSnapshotPath, const std::filesystem::path& aPrelude, std::string_view aDefines, const std::vector<tokenizer::Token>& aTokens);
+
+	// A snapshot made with other predefines than aDefines can not be used
+	PrecompiledHeader(const std::filesystem::path& aSnapshotPath, std::string_view aDefines = {});
+
+	// The prelude the snapshot was made from, empty if the snapshot could not be read at all
+	const std::filesystem::path& GetPrelude() const { return myPrelude; }
+
+	// What was predefined before the prelude when the snapshot was made
+	const std::string& GetDefines() const { return myDefines; }
+
+	// Why the snapshot can not be used, empty if it can
+	const std::string& GetProblem() const { return myProblem; }
+
+	// Whether a file the prelude read has changed since the snapshot was opened, for processes that keep it open
+	bool HasChanged() const;
+
+	// Resets the preprocessor to the state right after the prelude
+	void Apply() const;
+
+	// The tokens the prelude produced, the same for every file so they only need to be read once
+	std::vector<tokenizer::Token> GetTokens() const;
+
+	static constexpr uint32_t ourVersion = 2;
+
+private:
+	struct Header;
+	struct StringRecord;
+	struct FileRecord;
+	struct DependencyRecord;
+	struct TokenRecord;
+	struct MacroRecord;
+	struct ComponentRecord;
+
+	template<class Record>
+	std::optional<std::span<const Record>> Section(uint64_t aOffset, uint64_t aCount) const;
+
+	std::optional<std::filesystem::path> FindChangedDependency() const;
+	std::string_view String(const StringRecord& aString) const;
+	tokenizer::Token MakeToken(const TokenRecord& aToken) const;
+
+	MappedFile myFile;
+	std::filesystem::path myPrelude;
+	std::string myDefines;
+	std::string myProblem;
+
+	const Header* myHeader = nullptr;
+	std::string_view myStrings;
+	std::vector<std::filesystem::path> myFiles;
+};
+
+#endif // PRECOMPILER_PRECOMPILED_HEADER_H
@@ -0,0 +1,62 @@
+#include "precompiler/PreprocessedOutput.h"
+
+#include <string>
+
+PreprocessedOutput::PreprocessedOutput(BufferedWriter& aWriter)
+	: myWriter(aWriter)
+{
+}
+
+PreprocessedOutput::~PreprocessedOutput()
+{
+	if (!myIsEmpty)
+		myWriter.Write('\n');
+}
+
+void PreprocessedOutput::Consume(const tokenizer::Token& aToken)
+{
+	if (myIsEmpty || aToken.myFile.native() != myFile.native())
+	{
+		WriteLineMarker(aToken);
+	}
+	else if (aToken.myLine > myLine)
+	{
+		if (aToken.myLine - myLine > ourMaxBlankLines)
+		{
+			WriteLineMarker(aToken);
+		}
+		else
+		{
+			for (; myLine < aToken.myLine; myLine++)
+				myWriter.Write('\n');
+		}
+	}
+	else
+	{
+		// always separated, tokens that were adjacent in the source can lex as something else when adjacent after expansion
+		myWriter.Write(' ');
+	}
+
+	myWriter.Write(aToken.myRawText);
+}
+
+void PreprocessedOutput::WriteLineMarker(const tokenizer::Token& aToken)
+{
+	if (!myIsEmpty)
+		myWriter.Write('\n');
+
+	myWriter.Write("# ");
+	myWriter.Write(std::to_string(aToken.myLine + 1));
+	myWriter.Write(" \"");
+	for (char c : aToken.myFile.string())
+	{
+		if (c == '\\' || c == '"')
+			myWriter.Write('\\');
+		myWriter.Write(c);
+	}
+	myWriter.Write("\"\n");
+
+	myFile = aToken.myFile;
+	myLine = aToken.myLine;
+	myIsEmpty = false;
+}
@@ -0,0 +1,31 @@
+#ifndef PRECOMPILER_PREPROCESSED_OUTPUT_H
+#define PRECOMPILER_PREPROCESSED_OUTPUT_H
+
+#include <filesystem>
+
+#include "tokenizer/tokenStream.h"
+#include "tools/BufferedWriter.h"
+
+// Writes preprocessed tokens as source text, keeping them on the lines they came from and marking jumps with # <line> "<file>"
+// Tokens are written as they arrive so the translation unit never has to be held in memory
+class PreprocessedOutput : public tokenizer::TokenSink
+{
+public:
+	PreprocessedOutput(BufferedWriter& aWriter);
+	~PreprocessedOutput();
+
+	void Consume(const tokenizer::Token& aToken) override;
+
+private:
+	void WriteLineMarker(const tokenizer::Token& aToken);
+
+	// More blank lines than this are replaced by a line marker
+	static constexpr size_t ourMaxBlankLines = 8;
+
+	BufferedWriter& myWriter;
+	std::filesystem::path myFile;
+	size_t myLine = 0;
+	bool myIsEmpty = true;
+};
+
+#endif // PRECOMPILER_PREPROCESSED_OUTPUT_H
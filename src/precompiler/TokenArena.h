@@ -0,0 +1,85 @@
+#ifndef PRECOMPILER_TOKEN_ARENA_H
+#define PRECOMPILER_TOKEN_ARENA_H
+
+#include <algorithm>
+#include <memory>
+#include <ranges>
+#include <span>
+#include <vector>
+
+// Bump allocator handing out contiguous spans, a span stays valid until the arena is rewound past it.
+// Blocks are never reallocated or freed on rewind so a steady state workload does not touch the heap.
+template<class T>
+class TokenArena
+{
+public:
+	struct Mark
+	{
+		size_t myBlock = 0;
+		size_t myUsed = 0;
+	};
+
+	std::span<T> Allocate(size_t aCount)
+	{
+		if (myBlocks.empty())
+			myBlocks.push_back(MakeBlock(aCount));
+
+		if (myBlocks[myCurrent].mySize - myUsed < aCount)
+		{
+			myCurrent++;
+			myUsed = 0;
+
+			if (myCurrent == myBlocks.size() || myBlocks[myCurrent].mySize < aCount)
+				myBlocks.insert(myBlocks.begin() + myCurrent, MakeBlock(aCount));
+		}
+
+		std::span<T> out(myBlocks[myCurrent].myData.get() + myUsed, aCount);
+		myUsed += aCount;
+		return out;
+	}
+
+	template<std::ranges::sized_range Range>
+	std::span<T> Copy(const Range& aRange)
+	{
+		std::span<T> out = Allocate(std::ranges::size(aRange));
+		std::ranges::copy(aRange, out.begin());
+		return out;
+	}
+
+	Mark GetMark() const
+	{
+		return { myCurrent, myUsed };
+	}
+
+	void Rewind(Mark aMark)
+	{
+		myCurrent = aMark.myBlock;
+		myUsed = aMark.myUsed;
+	}
+
+	void Clear()
+	{
+		Rewind({});
+	}
+
+private:
+	struct Block
+	{
+		std::unique_ptr<T[]> myData;
+		size_t mySize;
+	};
+
+	static Block MakeBlock(size_t aMinimumSize)
+	{
+		size_t size = std::max(aMinimumSize, ourBlockSize);
+		return { std::make_unique<T[]>(size), size };
+	}
+
+	static constexpr size_t ourBlockSize = 4096;
+
+	std::vector<Block> myBlocks;
+	size_t myCurrent = 0;
+	size_t myUsed = 0;
+};
+
+#endif // PRECOMPILER_TOKEN_ARENA_H
@@ -6,17 +6,34 @@
 #include <ranges>
 
 #include <iostream>
+#include <utility>
 
 #include "common/CompilerContext.h"
+#include "common/IncludeReport.h"
 #include "common/IteratorRange.h"
+#include "common/TimeTrace.h"
+#include "common/Trace.h"
 #include "precompiler/precompiler.h"
+#include "precompiler/DependencyScanner.h"
 #include "tokenizer/tokenizer.h"
+#include "tokenizer/tokenMatcher.h"
 
-Precompiler::Context Precompiler::myContext;
+thread_local Precompiler::Context Precompiler::myThreadContext;
+thread_local Precompiler::Context* Precompiler::myContext = &Precompiler::myThreadContext;
 
 void Precompiler::ResetContext()
 {
-	myContext = Context();
+	*myContext = Context();
+}
+
+Precompiler::Scope::Scope(Context& aContext)
+	: myPrevious(std::exchange(myContext, &aContext))
+{
+}
+
+Precompiler::Scope::~Scope()
+{
+	myContext = myPrevious;
 }
 
 void Precompiler::ConsumeLine(FileContext& aFileContext, tokenizer::TokenStream& aOutTokens, const std::vector<tokenizer::Token>& aTokens)
@@ -52,7 +69,10 @@ void Precompiler::ConsumeLine(FileContext& aFileContext, tokenizer::TokenStream&
 				switch (identifier->myType)
 				{
 				case tokenizer::Token::Type::kw_if:
-					aFileContext.myIfStack.push(EvaluateExpression(IteratorRange(identifier + 1, std::end(aTokens))));
+					if (currentState != IfState::Active)
+						aFileContext.myIfStack.push(IfState::HasBeenActive); // nested in a skipped group, none of its branches can be taken
+					else
+						aFileContext.myIfStack.push(EvaluateExpression(IteratorRange(identifier + 1, std::end(aTokens))));
 					return;
 				case tokenizer::Token::Type::kw_else:
 					if (currentState == IfState::Active)
@@ -76,10 +96,12 @@ void Precompiler::ConsumeLine(FileContext& aFileContext, tokenizer::TokenStream&
 					}
 					else if (identifier->myRawText == "ifdef")
 					{
-						if (std::optional<iterator> ifdefIt = getNextNotWhitespace(identifier + 1))
+						if (currentState != IfState::Active)
+							aFileContext.myIfStack.push(IfState::HasBeenActive);
+						else if (std::optional<iterator> ifdefIt = getNextNotWhitespace(identifier + 1))
 						{
 							iterator& ifdef = *ifdefIt;
-							aFileContext.myIfStack.push(myContext.myMacros.count(ifdef->myRawText) != 0 ? IfState::Active : IfState::Inactive);
+							aFileContext.myIfStack.push(myContext->myMacros.count(ifdef->myRawText) != 0 ? IfState::Active : IfState::Inactive);
 						}
 						else
 						{
@@ -88,10 +110,12 @@ void Precompiler::ConsumeLine(FileContext& aFileContext, tokenizer::TokenStream&
 					}
 					else if (identifier->myRawText == "ifndef")
 					{
-						if (std::optional<iterator> ifdefIt = getNextNotWhitespace(identifier + 1))
+						if (currentState != IfState::Active)
+							aFileContext.myIfStack.push(IfState::HasBeenActive);
+						else if (std::optional<iterator> ifdefIt = getNextNotWhitespace(identifier + 1))
 						{
 							iterator& ifdef = *ifdefIt;
-							aFileContext.myIfStack.push(myContext.myMacros.count(ifdef->myRawText) != 0 ? IfState::Inactive : IfState::Active);
+							aFileContext.myIfStack.push(myContext->myMacros.count(ifdef->myRawText) != 0 ? IfState::Inactive : IfState::Active);
 						}
 						else
 						{
@@ -104,6 +128,25 @@ void Precompiler::ConsumeLine(FileContext& aFileContext, tokenizer::TokenStream&
 							Define(IteratorRange(identifier + 1, std::end(aTokens)));
 						return;
 					}
+					else if (identifier->myRawText == "pragma")
+					{
+						if (currentState != IfState::Active)
+							return;
+
+						std::optional<iterator> pragmaIt = getNextNotWhitespace(identifier + 1);
+						if (pragmaIt && (*pragmaIt)->myRawText == "once")
+							myContext->myOnceFiles.insert(std::filesystem::weakly_canonical(CompilerContext::GetCurrentFile()));
+					}
+					else if (identifier->myRawText == "undef")
+					{
+						if (currentState != IfState::Active)
+							return;
+
+						if (std::optional<iterator> undefIt = getNextNotWhitespace(identifier + 1))
+							Undefine(**undefIt);
+						else
+							CompilerContext::EmitError("expected an identifier after #undef", *identifier);
+					}
 					return;
 
 
@@ -119,12 +162,37 @@ void Precompiler::ConsumeLine(FileContext& aFileContext, tokenizer::TokenStream&
 			return;
 		default:
 			if (currentState == IfState::Active)
-				aOutTokens << TranslateTokenRange(aTokens);
+				TranslateTokenRange(aTokens, aOutTokens);
 			return;
 		}
 	}
 }
 
+void Precompiler::Predefine(std::string_view aDefinitions)
+{
+	if (aDefinitions.empty())
+		return;
+
+	FileContext fileContext;
+	tokenizer::TokenStream discarded;
+
+	for (std::string_view definition : aDefinitions | std::views::split(',') | std::views::transform([](auto aPart) { return std::string_view(aPart.begin(), aPart.end()); }))
+	{
+		if (definition.empty())
+			continue;
+
+		size_t equals = definition.find('=');
+		std::string value = equals == std::string_view::npos ? "1" : std::string(definition.substr(equals + 1));
+		std::string line = "#define " + std::string(definition.substr(0, equals)) + " " + value;
+
+		std::vector<tokenizer::Token> tokens;
+		tokenizer::TokenMatcher::Context tokenContext;
+		tokenizer::TokenMatcher::MatchTokens(tokens, line, tokenContext);
+
+		ConsumeLine(fileContext, discarded, tokens);
+	}
+}
+
 void Precompiler::IncludeFile(tokenizer::TokenStream& aOutTokens, const std::vector<tokenizer::Token>& aTokens, std::vector<tokenizer::Token>::const_iterator aIncludeIt)
 {
 	using iterator = std::vector<tokenizer::Token>::const_iterator;
@@ -148,7 +216,23 @@ void Precompiler::IncludeFile(tokenizer::TokenStream& aOutTokens, const std::vec
 			bool expandedSearch = path->myRawText[0] == '<';
 			if (std::optional<std::filesystem::path> expectedFilePath = CompilerContext::FindFile(rawPath, expandedSearch))
 			{
-				aOutTokens << tokenizer::Tokenize(*expectedFilePath);
+				std::filesystem::path canonical = std::filesystem::weakly_canonical(*expectedFilePath);
+				if (myContext->myOnceFiles.contains(canonical))
+				{
+					IncludeReport::Skip(canonical);
+				}
+				else
+				{
+					myContext->myIncludedFiles.push_back(canonical);
+
+					TimeTrace::Span span("IncludeFile", TimeTrace::IsEnabled() ? expectedFilePath->generic_string() : std::string());
+					CompilerContext::PushFile(*expectedFilePath);
+					if (myContext->myScanner)
+						myContext->myScanner->ScanFile(*expectedFilePath);
+					else
+						tokenizer::Tokenize(*expectedFilePath, aOutTokens);
+					CompilerContext::PopFile();
+				}
 			}
 			else
 			{
@@ -190,261 +274,435 @@ Precompiler::FileContext::~FileContext()
 
 namespace precompiler_internal_math
 {
+	// Binding strength of the binary operators allowed in a #if expression, higher binds tighter, 0 means it is not a binary operator
+	int BinaryPrecedence(tokenizer::Token::Type aType)
+	{
+		switch (aType)
+		{
+		case tokenizer::Token::Type::Or:				return 1;
+		case tokenizer::Token::Type::And:				return 2;
+		case tokenizer::Token::Type::BitOr:				return 3;
+		case tokenizer::Token::Type::Xor:				return 4;
+		case tokenizer::Token::Type::BitAnd:			return 5;
+		case tokenizer::Token::Type::EqualEqual:
+		case tokenizer::Token::Type::NotEquals:			return 6;
+		case tokenizer::Token::Type::Less:
+		case tokenizer::Token::Type::Greater:
+		case tokenizer::Token::Type::LessEqual:
+		case tokenizer::Token::Type::GreaterEqual:		return 7;
+		case tokenizer::Token::Type::LessLess:
+		case tokenizer::Token::Type::GreaterGreater:	return 8;
+		case tokenizer::Token::Type::Plus:
+		case tokenizer::Token::Type::Minus:				return 9;
+		case tokenizer::Token::Type::Star:
+		case tokenizer::Token::Type::Div:
+		case tokenizer::Token::Type::Mod:				return 10;
+		default:
+			return 0;
+		}
+	}
 
-	const std::vector<tokenizer::Token::Type> unaryOperators =
+	PreprocessorNumber ApplyUnary(tokenizer::Token::Type aOperator, PreprocessorNumber aValue, const tokenizer::Token& aLocation)
 	{
-		tokenizer::Token::Type::Not,
-		tokenizer::Token::Type::Complement,
-		tokenizer::Token::Type::Plus,
-		tokenizer::Token::Type::Minus,
-	};
+		using Unsigned = std::make_unsigned_t<PreprocessorNumber>;
+
+		switch (aOperator)
+		{
+		case tokenizer::Token::Type::Not:			return !aValue;
+		case tokenizer::Token::Type::Complement:	return ~aValue;
+		case tokenizer::Token::Type::Plus:			return aValue;
+		case tokenizer::Token::Type::Minus:			return static_cast<PreprocessorNumber>(Unsigned(0) - static_cast<Unsigned>(aValue));
+		default:
+			CompilerContext::EmitError("Only unary operators can can be used with a single operand", aLocation);
+			return 0;
+		}
+	}
 
-	const std::vector<std::function<PreprocessorNumber(PreprocessorNumber)>> unaryOperatorFunctors =
+	// aEvaluated is false for operands that are short circuited away, they are still parsed but must not produce errors
+	PreprocessorNumber ApplyBinary(tokenizer::Token::Type aOperator, PreprocessorNumber aLeft, PreprocessorNumber aRight, bool aEvaluated, const tokenizer::Token& aLocation)
 	{
-		[](PreprocessorNumber aFirst) { return !aFirst; },
-		[](PreprocessorNumber aFirst) { return ~aFirst; },
-		[](PreprocessorNumber aFirst) { return +aFirst; },
-		[](PreprocessorNumber aFirst) { return -aFirst; }
-	};
+		using Unsigned = std::make_unsigned_t<PreprocessorNumber>;
+		constexpr PreprocessorNumber bits = sizeof(PreprocessorNumber) * 8;
 
-	const std::vector<tokenizer::Token::Type> operators =
+		switch (aOperator)
+		{
+		case tokenizer::Token::Type::Star:			return static_cast<PreprocessorNumber>(static_cast<Unsigned>(aLeft) * static_cast<Unsigned>(aRight));
+		case tokenizer::Token::Type::Div:
+		case tokenizer::Token::Type::Mod:
+			if (aRight == 0)
+			{
+				if (aEvaluated)
+					CompilerContext::EmitError("Division by zero in preprocessor expression", aLocation);
+				return 0;
+			}
+			if (aRight == -1)
+				return aOperator == tokenizer::Token::Type::Div ? static_cast<PreprocessorNumber>(Unsigned(0) - static_cast<Unsigned>(aLeft)) : 0;
+
+			return aOperator == tokenizer::Token::Type::Div ? aLeft / aRight : aLeft % aRight;
+
+		case tokenizer::Token::Type::Plus:			return static_cast<PreprocessorNumber>(static_cast<Unsigned>(aLeft) + static_cast<Unsigned>(aRight));
+		case tokenizer::Token::Type::Minus:			return static_cast<PreprocessorNumber>(static_cast<Unsigned>(aLeft) - static_cast<Unsigned>(aRight));
+		case tokenizer::Token::Type::LessLess:		return aRight < 0 || aRight >= bits ? 0 : static_cast<PreprocessorNumber>(static_cast<Unsigned>(aLeft) << aRight);
+		case tokenizer::Token::Type::GreaterGreater:return aRight < 0 || aRight >= bits ? (aLeft < 0 ? -1 : 0) : aLeft >> aRight;
+		case tokenizer::Token::Type::Less:			return aLeft < aRight;
+		case tokenizer::Token::Type::Greater:		return aLeft > aRight;
+		case tokenizer::Token::Type::LessEqual:		return aLeft <= aRight;
+		case tokenizer::Token::Type::GreaterEqual:	return aLeft >= aRight;
+		case tokenizer::Token::Type::EqualEqual:	return aLeft == aRight;
+		case tokenizer::Token::Type::NotEquals:		return aLeft != aRight;
+		case tokenizer::Token::Type::BitAnd:		return aLeft & aRight;
+		case tokenizer::Token::Type::Xor:			return aLeft ^ aRight;
+		case tokenizer::Token::Type::BitOr:			return aLeft | aRight;
+		case tokenizer::Token::Type::And:			return aLeft && aRight;
+		case tokenizer::Token::Type::Or:			return aLeft || aRight;
+		default:
+			CompilerContext::EmitError("Unexpected token", aLocation);
+			return 0;
+		}
+	}
+
+	PreprocessorNumber EvaluateCharacter(std::string_view aText)
 	{
-		tokenizer::Token::Type::Div,
-		tokenizer::Token::Type::Star,
-		tokenizer::Token::Type::Mod,
+		std::string_view text = aText.substr(aText.find('\'') + 1);
+		if (text.empty() || text[0] == '\'')
+			return 0;
+
+		if (text[0] != '\\')
+			return static_cast<unsigned char>(text[0]);
 
-		tokenizer::Token::Type::Plus,
-		tokenizer::Token::Type::Minus,
+		if (text.size() < 2)
+			return 0;
 
-		tokenizer::Token::Type::BitAnd,
+		switch (text[1])
+		{
+		case 'n':	return '\n';
+		case 't':	return '\t';
+		case 'r':	return '\r';
+		case 'a':	return '\a';
+		case 'b':	return '\b';
+		case 'f':	return '\f';
+		case 'v':	return '\v';
+		case '0':	return '\0';
+		default:	return static_cast<unsigned char>(text[1]);
+		}
+	}
+}
 
-		tokenizer::Token::Type::Xor,
+// Precedence climbing over the expanded tokens of a #if line, each token is visited once and nothing is allocated
+template<std::forward_iterator IteratorType>
+class Precompiler::ExpressionEvaluator
+{
+public:
+	ExpressionEvaluator(IteratorType aBegin, IteratorType aEnd)
+		: myAt(aBegin)
+		, myEnd(aEnd)
+	{
+	}
 
-		tokenizer::Token::Type::BitOr,
+	PreprocessorNumber Evaluate()
+	{
+		PreprocessorNumber result = Conditional(true);
 
-		tokenizer::Token::Type::And,
+		if (const ExpansionToken* trailing = Peek())
+		{
+			if (!myFailed && CompilerContext::IsWarningEnabled(Warning::if_contamitaion))
+				CompilerContext::EmitWarning("Expected single expression", *trailing->myToken);
+		}
 
-		tokenizer::Token::Type::Or
-	};
+		return result;
+	}
 
-	const std::vector<std::function<PreprocessorNumber(PreprocessorNumber, PreprocessorNumber)>> operatorFunctors =
+private:
+	PreprocessorNumber Conditional(bool aEvaluated)
 	{
-		[](PreprocessorNumber aFirst, PreprocessorNumber aSecond) { return aFirst / aSecond; },
-		[](PreprocessorNumber aFirst, PreprocessorNumber aSecond) { return aFirst * aSecond; },
-		[](PreprocessorNumber aFirst, PreprocessorNumber aSecond) { return aFirst % aSecond; },
+		PreprocessorNumber condition = Binary(1, aEvaluated);
 
-		[](PreprocessorNumber aFirst, PreprocessorNumber aSecond) { return aFirst + aSecond; },
-		[](PreprocessorNumber aFirst, PreprocessorNumber aSecond) { return aFirst - aSecond; },
+		const ExpansionToken* question = Peek();
+		if (!question || question->Type() != tokenizer::Token::Type::Question)
+			return condition;
+		myAt++;
 
-		[](PreprocessorNumber aFirst, PreprocessorNumber aSecond) { return aFirst & aSecond; },
+		PreprocessorNumber whenTrue = Conditional(aEvaluated && condition != 0);
 
-		[](PreprocessorNumber aFirst, PreprocessorNumber aSecond) { return aFirst ^ aSecond; },
+		const ExpansionToken* colon = Peek();
+		if (!colon || colon->Type() != tokenizer::Token::Type::Colon)
+		{
+			Fail("Expected a ':' in conditional expression", colon);
+			return 0;
+		}
+		myAt++;
 
-		[](PreprocessorNumber aFirst, PreprocessorNumber aSecond) { return aFirst | aSecond; },
+		PreprocessorNumber whenFalse = Conditional(aEvaluated && condition == 0);
 
-		[](PreprocessorNumber aFirst, PreprocessorNumber aSecond) { return aFirst && aSecond; },
+		return condition != 0 ? whenTrue : whenFalse;
+	}
 
-		[](PreprocessorNumber aFirst, PreprocessorNumber aSecond) { return aFirst || aSecond; },
-	};
+	PreprocessorNumber Binary(int aMinPrecedence, bool aEvaluated)
+	{
+		PreprocessorNumber left = Unary(aEvaluated);
+
+		while (const ExpansionToken* op = Peek())
+		{
+			int precedence = precompiler_internal_math::BinaryPrecedence(op->Type());
+			if (precedence == 0 || precedence < aMinPrecedence)
+				break;
+			myAt++;
+
+			bool evaluateRight = aEvaluated;
+			if (op->Type() == tokenizer::Token::Type::And)
+				evaluateRight = aEvaluated && left != 0;
+			else if (op->Type() == tokenizer::Token::Type::Or)
+				evaluateRight = aEvaluated && left == 0;
 
-	void AddValue(PreprocessorNumber aValue, std::vector<tokenizer::Token>& aPendingOperators, std::vector<PreprocessorNumber>& aValues)
+			PreprocessorNumber right = Binary(precedence + 1, evaluateRight);
+			PreprocessorNumber result = precompiler_internal_math::ApplyBinary(op->Type(), left, right, evaluateRight, *op->myToken);
+
+			if (Trace::IsOn(CompilerContext::Verbose::PrecompilerMath))
+				Trace::Line() << "did " << tokenizer::Token::TypeToString(op->Type()) << " on " << left << " and " << right << " resulting in " << result;
+
+			left = result;
+		}
+
+		return left;
+	}
+
+	PreprocessorNumber Unary(bool aEvaluated)
 	{
+		const ExpansionToken* op = Peek();
+		if (!op)
+			return Primary(aEvaluated);
+
+		switch (op->Type())
 		{
-			if (aPendingOperators.size() == aValues.size())
+		case tokenizer::Token::Type::Not:
+		case tokenizer::Token::Type::Complement:
+		case tokenizer::Token::Type::Plus:
+		case tokenizer::Token::Type::Minus:
 			{
-				aValues.push_back(aValue);
-				return;
+				myAt++;
+				PreprocessorNumber value = Unary(aEvaluated);
+				PreprocessorNumber result = precompiler_internal_math::ApplyUnary(op->Type(), value, *op->myToken);
+
+				if (Trace::IsOn(CompilerContext::Verbose::PrecompilerMath))
+					Trace::Line() << "performed unary transform " << tokenizer::Token::TypeToString(op->Type()) << " on " << value;
+
+				return result;
 			}
+		default:
+			return Primary(aEvaluated);
+		}
+	}
+
+	PreprocessorNumber Primary(bool aEvaluated)
+	{
+		const ExpansionToken* tok = Peek();
+		if (!tok)
+		{
+			Fail("Expected an expression", nullptr);
+			return 0;
+		}
+
+		switch (tok->Type())
+		{
+		case tokenizer::Token::Type::Integer_literal:
+			myAt++;
+			return static_cast<PreprocessorNumber>(tokenizer::Token::EvaluateIntegral(tok->Spelling()));
 
-			tokenizer::Token op = aPendingOperators.back();
-			aPendingOperators.pop_back();
+		case tokenizer::Token::Type::Char_literal:
+			myAt++;
+			return precompiler_internal_math::EvaluateCharacter(tok->Spelling());
 
-			for (size_t i = 0; i < unaryOperators.size(); i++)
+		case tokenizer::Token::Type::kw_true:
+			myAt++;
+			return 1;
+
+		case tokenizer::Token::Type::kw_false:
+			myAt++;
+			return 0;
+
+		case tokenizer::Token::Type::L_Paren:
 			{
-				if (op.myType == unaryOperators[i])
-				{
-					if (CompilerContext::GetFlag("verbose") == "precompiler_math")
-						std::cout << "performed unary transform " << tokenizer::Token::TypeToString(op.myType) << " on " << aValue << "\n";
+				myAt++;
+				PreprocessorNumber value = Conditional(aEvaluated);
 
-					AddValue(unaryOperatorFunctors[i](aValue), aPendingOperators, aValues);
-					return;
+				const ExpansionToken* closing = Peek();
+				if (!closing || closing->Type() != tokenizer::Token::Type::R_Paren)
+				{
+					Fail("Unmatched parenthesis", tok);
+					return value;
 				}
+				myAt++;
+				return value;
 			}
 
-			CompilerContext::EmitError("Only unary operators can can be used with a single operand", op);
-		}
-	}
-}
+		default:
+			if (!tokenizer::Token::IsTextToken(tok->Spelling()))
+			{
+				Fail("Unexpected token", tok);
+				return 0;
+			}
 
+			myAt++;
+			if (tok->Spelling() == "defined")
+				return Defined(*tok);
 
-template<std::ranges::contiguous_range TokenCollection>
-inline std::vector<tokenizer::Token> Precompiler::TranslateTokenRange(TokenCollection aTokens)
-{
-	tokenizer::TokenStream stream;
+			// identifiers that survived macro expansion evaluate to 0
+			return 0;
+		}
+	}
 
-	auto filtered = aTokens | tokenizer::token_helpers::IsNotWhitespace;
-	auto it = std::ranges::begin(aTokens);
-	auto end = std::ranges::end(aTokens);
-	while (it != end)
+	PreprocessorNumber Defined(const ExpansionToken& aDefined)
 	{
-		const tokenizer::Token& tok = *it;
+		const ExpansionToken* operand = Peek();
+		bool parenthesized = operand && operand->Type() == tokenizer::Token::Type::L_Paren;
+		if (parenthesized)
+		{
+			myAt++;
+			operand = Peek();
+		}
 
-		decltype(Context::myMacros)::iterator potentialMacro = myContext.myMacros.find(tok.myRawText);
-		if (potentialMacro != std::end(myContext.myMacros))
+		if (!operand || !tokenizer::Token::IsTextToken(operand->Spelling()))
 		{
-			it++;
-			if (std::optional<std::vector<tokenizer::Token>> result = potentialMacro->second.Evaluate(it, end))
+			Fail("Expected an identifier after defined", operand ? operand : &aDefined);
+			return 0;
+		}
+		myAt++;
+
+		if (parenthesized)
+		{
+			const ExpansionToken* closing = Peek();
+			if (!closing || closing->Type() != tokenizer::Token::Type::R_Paren)
 			{
-				stream << *result;
-				continue;
+				Fail("Expected a ')'", closing ? closing : operand);
+				return 0;
 			}
+			myAt++;
 		}
 
-		if (!tok.IsPrepoccessorSpecific())
-			stream << tok;
+		return myContext->myMacros.count(operand->Spelling()) != 0 ? 1 : 0;
+	}
 
-		it++;
+	const ExpansionToken* Peek()
+	{
+		return myAt != myEnd ? &*myAt : nullptr;
 	}
 
-	return std::move(stream).Get();
-}
+	void Fail(const std::string& aMessage, const ExpansionToken* aToken)
+	{
+		if (myFailed)
+			return;
+		myFailed = true;
 
-template<std::ranges::contiguous_range TokenCollection>
-inline Precompiler::IfState Precompiler::EvaluateExpression(TokenCollection aTokens)
-{
-	std::vector<tokenizer::Token> buffer = TranslateTokenRange(aTokens);
+		if (aToken)
+			CompilerContext::EmitError(aMessage, *aToken->myToken);
+		else
+			CompilerContext::EmitError(aMessage, CompilerContext::GetCurrentFile(), CompilerContext::npos);
+	}
+
+	IteratorType myAt;
+	IteratorType myEnd;
+	bool myFailed = false;
+};
 
-	return EvalutateSequence(buffer) == 0 ? IfState::Inactive : IfState::Active;
-}
 
 template<std::ranges::contiguous_range TokenCollection>
-inline PreprocessorNumber Precompiler::EvalutateSequence(TokenCollection aTokens)
+inline void Precompiler::TranslateTokenRange(const TokenCollection& aTokens, tokenizer::TokenStream& aOutTokens)
 {
-	if (std::ranges::size(aTokens) == 0)
-	{
-		CompilerContext::EmitError("Expected an expression");
-		return 0;
-	}
+	TokenArena<ExpansionToken>::Mark mark = myContext->myArena.GetMark();
 
-	auto begin = std::ranges::begin(aTokens);
-	auto end = std::ranges::end(aTokens);
-	auto it = begin;
+	myContext->myResult.clear();
+	Expand(ToExpansionTokens(aTokens), myContext->myResult, false);
 
-	std::vector<tokenizer::Token> pendingOperators;
-	std::vector<PreprocessorNumber> values;
+	const tokenizer::Token* lineBegin = std::ranges::data(aTokens);
+	const tokenizer::Token* lineEnd = lineBegin + std::ranges::size(aTokens);
+	const tokenizer::Token* nextOnLine = lineBegin;
 
-	while (it != end)
+	// tokens out of a macro body are placed where the macro was invoked, the first token on the line not yet written
+	auto invocation = [&]() -> const tokenizer::Token&
 	{
-		const tokenizer::Token& tok = *it;
-		switch (tok.myType)
-		{
-		case tokenizer::Token::Type::Integer_literal:
-			precompiler_internal_math::AddValue(tok.EvaluateIntegral(), pendingOperators, values);
-			break;
-		case tokenizer::Token::Type::L_Paren: {
+		const tokenizer::Token* it = nextOnLine;
+		while (it != lineEnd && it->IsPrepoccessorSpecific())
 			it++;
-			auto matching = FindMatchingEndParen(it, end) - 1;
-			PreprocessorNumber number = EvalutateSequence(IteratorRange(it, matching));
-			precompiler_internal_math::AddValue(number, pendingOperators, values);
-			it = matching;
-		}
-								 break;
-		case tokenizer::Token::Type::WhiteSpace:
-		case tokenizer::Token::Type::NewLine:
-			break;
-		default:
-			if (values.empty()) //TODO: this should be when equal not when empty
-			{
-				if (std::find(std::begin(precompiler_internal_math::unaryOperators), std::end(precompiler_internal_math::unaryOperators), tok.myType) != std::end(precompiler_internal_math::unaryOperators))
-					pendingOperators.push_back(tok);
-				else
-					CompilerContext::EmitError("Unexpected token", tok);
-			}
-			else
-			{
-				if (std::find(std::begin(precompiler_internal_math::operators), std::end(precompiler_internal_math::operators), tok.myType) != std::end(precompiler_internal_math::operators))
-					pendingOperators.push_back(tok);
-				else
-					CompilerContext::EmitError("Unexpected token", tok);
-			}
+		return it != lineEnd ? *it : *(lineEnd - 1);
+	};
 
-			break;
-		}
-		it++;
-	}
+	IncludeReport::CountTokens(myContext->myResult.size());
 
-	for (size_t opIndex = 0; opIndex < precompiler_internal_math::operators.size(); opIndex++)
+	for (const ExpansionToken& tok : myContext->myResult)
 	{
-		const tokenizer::Token::Type& op = precompiler_internal_math::operators[opIndex];
+		bool isOnLine = !std::less<const tokenizer::Token*>()(tok.myToken, lineBegin) && std::less<const tokenizer::Token*>()(tok.myToken, lineEnd);
 
-		for (size_t i = 0; i < pendingOperators.size(); i++)
+		if (isOnLine && !tok.IsSynthesized())
 		{
-			if (pendingOperators[i].myType == op)
-			{
-				if (values.size() < i + 1)
-				{
-					CompilerContext::EmitError("Incomplete expression");
-					return 0;
-				}
-				PreprocessorNumber first = values[i];
-				PreprocessorNumber second = values[i + 1];
-				PreprocessorNumber result = precompiler_internal_math::operatorFunctors[opIndex](first, second);
+			if (!tok.myToken->IsPrepoccessorSpecific())
+				aOutTokens << *tok.myToken;
 
-				if (CompilerContext::GetFlag("verbose") == "precompiler_math")
-					std::cout << "did " << tokenizer::Token::TypeToString(op) << " [" << opIndex << "] on " << first << " and " << second << " resulting in " << result << "\n";
+			nextOnLine = tok.myToken + 1;
+			continue;
+		}
 
-				values.erase(std::begin(values) + i, std::begin(values) + 2 + i);
-				values.insert(std::begin(values) + i, result);
+		tokenizer::Token moved = *tok.myToken;
+		if (tok.IsSynthesized())
+		{
+			moved.myType = tok.Type();
+			moved.myRawText = tok.Spelling();
+		}
 
-				pendingOperators.erase(std::begin(pendingOperators) + i);
-				i--;
-			}
+		if (!isOnLine)
+		{
+			const tokenizer::Token& location = invocation();
+			moved.myFile = location.myFile;
+			moved.myLine = location.myLine;
+			moved.myColumn = location.myColumn;
 		}
-	}
 
-	if (values.empty())
-	{
-		CompilerContext::EmitError("Expected an expression", *it);
-		return 0;
+		if (!moved.IsPrepoccessorSpecific())
+			aOutTokens << moved;
 	}
 
-	if (values.size() > 1 && CompilerContext::IsWarningEnabled("if_contamitaion"))
+	myContext->myArena.Rewind(mark);
+	myContext->mySpellings.Clear();
+}
+
+template<std::ranges::contiguous_range TokenCollection>
+inline Precompiler::ExpansionSpan Precompiler::ToExpansionTokens(TokenCollection& aTokens)
+{
+	myContext->myLine.clear();
+
+	const tokenizer::Token* previous = nullptr;
+	for (const tokenizer::Token& tok : aTokens)
 	{
-		CompilerContext::EmitWarning("Expected single expression", *begin);
+		if (tok.IsPrepoccessorSpecific())
+			continue;
+
+		myContext->myLine.push_back({ &tok, tok.myRawText, tok.myType, HideSets::Empty, previous && HasLeadingSpace(*previous, tok) });
+		previous = &tok;
 	}
 
-	std::cout << "\n";
-	return values[0];
+	return myContext->myLine;
 }
 
-template<std::forward_iterator IteratorType>
-inline IteratorType Precompiler::FindMatchingEndParen(IteratorType aBegin, IteratorType aEnd)
+template<std::ranges::contiguous_range TokenCollection>
+inline Precompiler::IfState Precompiler::EvaluateExpression(TokenCollection aTokens)
 {
-	size_t depth = 1;
-	IteratorType it = aBegin;
-	while (it != aEnd && depth > 0)
-	{
-		switch (it->myType)
-		{
-		case tokenizer::Token::Type::L_Paren:
-			depth++;
-			break;
+	TokenArena<ExpansionToken>::Mark mark = myContext->myArena.GetMark();
 
-		case tokenizer::Token::Type::R_Paren:
-			depth--;
-			break;
-		}
-		it++;
-	}
-	if (depth > 0)
-	{
-		if (aBegin != aEnd)
-			CompilerContext::EmitError("Unmatched parenthesis", *(aEnd - 1));
-		else
-			CompilerContext::EmitError("Unmatched parenthesis", CompilerContext::GetCurrentFile(),  CompilerContext::npos);
-	}
+	myContext->myResult.clear();
+	Expand(ToExpansionTokens(aTokens), myContext->myResult, true);
+
+	IfState state = EvalutateSequence(myContext->myResult) == 0 ? IfState::Inactive : IfState::Active;
+
+	myContext->myArena.Rewind(mark);
+	myContext->mySpellings.Clear();
+	return state;
+}
+
+template<std::ranges::contiguous_range TokenCollection>
+inline PreprocessorNumber Precompiler::EvalutateSequence(TokenCollection aTokens)
+{
+	ExpressionEvaluator<std::ranges::iterator_t<TokenCollection>> evaluator(std::ranges::begin(aTokens), std::ranges::end(aTokens));
 
-	return it;
+	return evaluator.Evaluate();
 }
 
 
@@ -455,7 +713,26 @@ inline void Precompiler::Define(TokenCollection aTokens)
 	if(macro.myIdentifier.empty())
 		return;
 
-	myContext.myMacros.emplace(macro.myIdentifier, macro);
+	macro.myId = myContext->myMacroCounter++;
+
+	InvalidateCachesUsing(macro.myIdentifier);
+	std::string identifier = macro.myIdentifier;
+	myContext->myMacros.insert_or_assign(std::move(identifier), std::move(macro));
+}
+
+void Precompiler::Undefine(const tokenizer::Token& aIdentifier)
+{
+	if (!aIdentifier.IsTextToken())
+	{
+		CompilerContext::EmitError("Expected an identifier", aIdentifier);
+		return;
+	}
+
+	InvalidateCachesUsing(aIdentifier.myRawText);
+
+	decltype(Context::myMacros)::iterator it = myContext->myMacros.find(aIdentifier.myRawText);
+	if (it != std::end(myContext->myMacros))
+		myContext->myMacros.erase(it);
 }
 
 template<std::ranges::input_range TokenCollection>
@@ -478,8 +755,17 @@ inline Precompiler::Macro::Macro(TokenCollection aRange)
 
 	myIdentifier = it->myRawText;
 
-	if(CompilerContext::GetFlag("verbose") == "macros")
-		std::cout << "new macro added [" << myIdentifier << "] \n";
+	// a definition that is wrong anywhere is dropped as a whole, the same as one without a name
+	auto reject = [this](const std::string& aMessage, auto... aLocation)
+	{
+		CompilerContext::EmitError(aMessage, aLocation...);
+		myIdentifier.clear();
+	};
+	size_t identifierLine = it->myLine;
+	size_t identifierEnd = it->myColumn + it->myRawText.length();
+
+	if (Trace::IsOn(CompilerContext::Verbose::Macros))
+		Trace::Line() << "new macro added [" << myIdentifier << "] ";
 
 	it++;
 	if (it == end)
@@ -487,241 +773,189 @@ inline Precompiler::Macro::Macro(TokenCollection aRange)
 
 	std::vector<std::string_view> arguments;
 
-	if (it->myType == tokenizer::Token::Type::L_Paren)
+	// only a parenthesis directly after the name makes a function-like macro, "#define A (1)" is object-like
+	if (it->myType == tokenizer::Token::Type::L_Paren && it->myLine == identifierLine && it->myColumn == identifierEnd)
 	{
+		myIsFunctionLike = true;
 		it++;
-		while (it != end)
+		if (it != end && it->myType == tokenizer::Token::Type::R_Paren)
 		{
-			if(it->myType == tokenizer::Token::Type::Ellipsis)
+			it++;
+		}
+		else
+		{
+			while (it != end)
 			{
-				myHasVariadic = true;
-				it++;
-				if (it == end)
+				if(it->myType == tokenizer::Token::Type::Ellipsis)
 				{
-					CompilerContext::EmitError("Expected a ')'", CompilerContext::GetCurrentFile(), CompilerContext::npos);
-					return;
+					myHasVariadic = true;
+					it++;
+					if (it == end)
+					{
+						reject("Expected a ')'", CompilerContext::GetCurrentFile(), CompilerContext::npos);
+						return;
+					}
+
+					if(it->myType != tokenizer::Token::Type::R_Paren)
+					{
+						reject("Expected a ')'", *it);
+						return;
+					}
+					it++;
+					break;
 				}
 
-				if(it->myType != tokenizer::Token::Type::R_Paren)
+				if (!it->IsTextToken())
 				{
-					CompilerContext::EmitError("Expected a ')'", *it);
+					reject("Expected an identifier", *it);
 					return;
 				}
+				arguments.emplace_back(it->myRawText);
 				it++;
-				break;
-			}
+				if (it == end)
+				{
+					reject("Expected a ',' or ')'", CompilerContext::GetCurrentFile(),  CompilerContext::npos);
+					return;
+				}
 
-			if (!it->IsTextToken())
-			{
-				CompilerContext::EmitError("Expected an identifier", *it);
-				return;
-			}
-			arguments.emplace_back(it->myRawText);
-			it++;
-			if (it == end)
-			{
-				CompilerContext::EmitError("Expected a ',' or ')'", CompilerContext::GetCurrentFile(),  CompilerContext::npos);
-				return;
-			}
+				if (it->myType == tokenizer::Token::Type::R_Paren)
+				{
+					it++;
+					break;
+				}
 
-			if (it->myType == tokenizer::Token::Type::R_Paren)
-			{
+				if (it->myType != tokenizer::Token::Type::Comma)
+				{
+					reject("Expected a ',' or ')'", *it);
+					return;
+				}
 				it++;
-				break;
-			}
-
-			if (it->myType != tokenizer::Token::Type::Comma)
-			{
-				CompilerContext::EmitError("Expected a ',' or ')'", *it);
-				return;
 			}
-			it++;
 		}
 	}
 
 	myArguments = arguments.size();
 
-	if (CompilerContext::GetFlag("verbose") == "macros")
+	if (Trace::IsOn(CompilerContext::Verbose::Macros) && !arguments.empty())
 	{
-		if(!arguments.empty())
-		{
-			std::cout << "arguments: ";
-			size_t index = 0;
-			for(const std::string_view& view : arguments)
-				std::cout << index++ << ":" << view << (index != arguments.size() ? ", " : (myHasVariadic ? " ... \n" : "\n"));
-		}
+		Trace::Line line;
+		line << "arguments: ";
+		size_t index = 0;
+		for(const std::string_view& view : arguments)
+			line << index++ << ":" << view << (index != arguments.size() ? ", " : (myHasVariadic ? " ... " : ""));
 	}
 
-	if (CompilerContext::GetFlag("verbose") == "macros")
-		std::cout << "Result:";
+	// printed as the components are made, it ends with the constructor
+	std::optional<Trace::Line> trace;
+	if (Trace::IsOn(CompilerContext::Verbose::Macros))
+		trace.emplace() << "Result:";
 
-	while(it != end)
+	// the parameter a name refers to, the variadic arguments come after the named ones
+	auto findArgument = [&](const tokenizer::Token& aToken) -> std::optional<size_t>
 	{
-		if(myHasVariadic)
-		{
-			if(it->myRawText == "__VA_ARGS__")
-			{
-				if (CompilerContext::GetFlag("verbose") == "macros")
-					std::cout << " [Variadic arguments]";
-
-				Component comp;
-				comp.myType = Component::Type::VariadicExpansion;
-				myComponents.push_back(comp);
-				it++;
+		if (myHasVariadic && aToken.myRawText == "__VA_ARGS__")
+			return arguments.size();
 
-				continue;
-			}
-		}
+		if (!aToken.IsTextToken())
+			return {};
 
-		if(it->IsTextToken())
+		for(size_t i = 0; i < arguments.size(); i++)
 		{
-			bool found = false;
-			for(size_t i = 0; i < arguments.size(); i++)
-			{
-				if (arguments[i] == it->myRawText)
-				{
-					if (CompilerContext::GetFlag("verbose") == "macros")
-						std::cout << " {" << i << "}";
-
-					Component comp;
-					comp.myType = Component::Type::Argument;
-					comp.myArgumentIndex = i;
-					myComponents.push_back(comp);
-					it++;
-
-					found = true;
-					break;
-				}
-			}
-			if (found)
-				continue;
+			if (arguments[i] == aToken.myRawText)
+				return i;
 		}
 
-		if (CompilerContext::GetFlag("verbose") == "macros")
-			std::cout << " " << it->myRawText;
-
-		Component comp;
-		comp.myType = Component::Type::Token;
-		comp.myToken = *it;
-		myComponents.push_back(comp);
-		it++;
-	}
-
-	if (CompilerContext::GetFlag("verbose") == "macros")
-		std::cout << "\n";
-}
+		return {};
+	};
 
-template<std::forward_iterator IteratorType>
-inline std::optional<std::vector<tokenizer::Token>> Precompiler::Macro::Evaluate(IteratorType& aInOutBegin, const IteratorType& aEnd)
-{
-	std::vector<tokenizer::Token> out;
-	
-	if(myArguments != 0 || myHasVariadic)
+	const tokenizer::Token* previous = nullptr;
+	while(it != end)
 	{
-		if(aInOutBegin == aEnd)
-			return {};
-
-		if(aInOutBegin->myType != tokenizer::Token::Type::L_Paren)
-			return {};
-
-		aInOutBegin++;
-	}
-
-	std::vector<std::vector<tokenizer::Token>> arguments;
-	std::vector<tokenizer::Token> variadic;
+		if (it->myType == tokenizer::Token::Type::Comment)
+		{
+			it++;
+			continue;
+		}
 
-	arguments.resize(myArguments);
+		Component comp;
+		comp.myHasLeadingSpace = previous && HasLeadingSpace(*previous, *it);
+		previous = &*it;
 
-	bool parenClosed = false;
-	for(size_t i = 0; i < myArguments; i++)
-	{
-		std::vector<tokenizer::Token> arg;
-		size_t depth = 0;
-		while (aInOutBegin != aEnd)
+		if (it->myType == tokenizer::Token::Type::HashHash)
 		{
-			if(aInOutBegin->myType == tokenizer::Token::Type::R_Paren)
+			if (myComponents.empty())
 			{
-				if(depth > 0)
-				{
-					depth--;
-					aInOutBegin++;
-					continue;
-				}
+				reject("'##' cannot appear at either end of a macro expansion", *it);
+				return;
+			}
 
-				if(i == myArguments - 1)
-				{
-					parenClosed = true;
-					aInOutBegin++;
-					break;
-				}
+			if (trace)
+				*trace << " ##";
 
-				CompilerContext::EmitError("Expected more arguments for macro", *aInOutBegin);
-				return {};
-			}
+			comp.myType = Component::Type::Paste;
+			comp.myToken = *it;
+			myComponents.push_back(comp);
+			it++;
+			continue;
+		}
 
-			if(aInOutBegin->myType == tokenizer::Token::Type::L_Paren)
-			{
-				depth++;
-				aInOutBegin++;
-				continue;
-			}
+		if (it->myType == tokenizer::Token::Type::Hash && myIsFunctionLike)
+		{
+			comp.myToken = *it;
+			it++;
 
-			if (depth == 0)
+			std::optional<size_t> argument = it != end ? findArgument(*it) : std::nullopt;
+			if (!argument)
 			{
-				if(aInOutBegin->myType == tokenizer::Token::Type::Comma)
-				{
-					aInOutBegin++;
-					break;
-				}
+				reject("'#' is not followed by a macro parameter", *comp.myToken);
+				return;
 			}
 
-			arguments[i].push_back(*aInOutBegin);
-			aInOutBegin++;
+			if (trace)
+				*trace << " #{" << *argument << "}";
+
+			comp.myType = Component::Type::Stringify;
+			comp.myArgumentIndex = *argument;
+			myComponents.push_back(comp);
+			previous = &*it;
+			it++;
+			continue;
 		}
-	}
 
-	if (myHasVariadic && !parenClosed)
-	{
-		size_t depth = 0;
-		while (aInOutBegin != aEnd)
+		if (std::optional<size_t> argument = findArgument(*it))
 		{
-			if(aInOutBegin->myType == tokenizer::Token::Type::L_Paren)
-				depth++;
+			if (*argument == arguments.size())
+			{
+				if (trace)
+					*trace << " [Variadic arguments]";
 
-			if(aInOutBegin->myType == tokenizer::Token::Type::R_Paren)
+				comp.myType = Component::Type::VariadicExpansion;
+			}
+			else
 			{
-				if(depth == 0)
-				{
-					aInOutBegin++;
-					break;
-				}
+				if (trace)
+					*trace << " {" << *argument << "}";
 
-				depth--;
+				comp.myType = Component::Type::Argument;
+				comp.myArgumentIndex = *argument;
 			}
 
-			variadic.push_back(*aInOutBegin);
-			aInOutBegin++;
+			myComponents.push_back(comp);
+			it++;
+			continue;
 		}
+
+		if (trace)
+			*trace << " " << it->myRawText;
+
+		comp.myType = Component::Type::Token;
+		comp.myToken = *it;
+		myComponents.push_back(comp);
+		it++;
 	}
 
-	for (Component& comp : myComponents)
+	if (!myComponents.empty() && myComponents.back().myType == Component::Type::Paste)
 	{
-		switch (comp.myType)
-		{
-		case Component::Type::Argument:
-			{
-				std::vector<tokenizer::Token>& arg = arguments[comp.myArgumentIndex];
-				out.insert(std::end(out), std::begin(arg), std::end(arg));
-			}
-			break;
-		case Component::Type::Token:
-			out.push_back(*comp.myToken);
-			break;
-		case Component::Type::VariadicExpansion:
-			out.insert(std::end(out), std::begin(variadic), std::end(variadic));
-			break;
-		}
+		reject("'##' cannot appear at either end of a macro expansion", *myComponents.back().myToken);
 	}
-
-	return out;
 }
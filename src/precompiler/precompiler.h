@@ -1,7 +1,15 @@
 
 #include "tokenizer/tokenStream.h"
 
+#include "precompiler/HideSet.h"
+#include "precompiler/TokenArena.h"
+
 #include <vector>
+#include <deque>
+#include <filesystem>
+#include <set>
+#include <span>
+#include <string_view>
 #include <ranges>
 #include <unordered_map>
 #include <functional>
@@ -9,6 +17,8 @@
 
 using PreprocessorNumber = long long;
 
+class DependencyScanner;
+
 class Precompiler
 {
 	enum class IfState
@@ -19,6 +29,23 @@ class Precompiler
 	};
 
 public:
+	// The macros and caches of one translation unit being preprocessed, each thread works in one of its own unless handed another by a Scope
+	struct Context;
+
+	// Makes the current thread preprocess into aContext for as long as it is alive, so a translation unit can move between threads
+	class Scope
+	{
+	public:
+		Scope(Context& aContext);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		Context* myPrevious;
+	};
+
 	class FileContext
 	{
 	public:
@@ -31,45 +58,151 @@ public:
 	};
 
 	static void ResetContext();
+
 	static void ConsumeLine(FileContext& aFileContext, tokenizer::TokenStream& aOutTokens, const std::vector<tokenizer::Token>& aTokens);
 
+	// Every file entered through an #include since the context was reset, canonical and in the order they were entered
+	static const std::vector<std::filesystem::path>& GetIncludedFiles() { return myContext->myIncludedFiles; }
+
+	// Defines the macros of a comma separated list of NAME or NAME=VALUE as if by #define NAME VALUE, NAME alone is defined as 1
+	static void Predefine(std::string_view aDefinitions);
+
 private:
+	friend class PrecompiledHeader;
+	friend class DependencyScanner;
+
+	// A token flowing through macro expansion, the token itself is never copied, only referred to
+	// Tokens made by # and ## point at the operator for their location and keep their spelling in the spelling arena
+	struct ExpansionToken
+	{
+		const tokenizer::Token* myToken = nullptr;
+		std::string_view mySpelling;
+		tokenizer::Token::Type myType = tokenizer::Token::Type::Invalid;
+		HideSets::Id myHideSet = HideSets::Empty;
+		bool myHasLeadingSpace = false;
+
+		tokenizer::Token::Type Type() const { return myType; }
+		std::string_view Spelling() const { return mySpelling; }
+		bool IsSynthesized() const { return mySpelling.data() != myToken->myRawText.data(); }
+	};
+
+	using ExpansionSpan = std::span<const ExpansionToken>;
+
+	struct StringHash
+	{
+		using is_transparent = void;
+		size_t operator()(std::string_view aText) const { return std::hash<std::string_view>()(aText); }
+	};
+
+	// A fully expanded macro invocation, only reusable when the expansion did not depend on anything after the invocation
+	// Tokens that came from the invocation's arguments are remembered by index so a reuse can point them at the new arguments
+	struct CachedExpansion
+	{
+		std::vector<ExpansionToken> myTokens;
+		std::vector<size_t> myArgumentTokens;
+		std::string mySpellings;
+		std::vector<std::string> myDependencies;
+		size_t mySubstitutedTokens = 0;
+		bool myIsReusable = false;
+	};
 
 	struct Macro
 	{
+		Macro() = default;
+
 		template<std::ranges::input_range TokenCollection>
 		Macro(TokenCollection aRange);
 
-		template<std::forward_iterator IteratorType>
-		std::optional<std::vector<tokenizer::Token>> Evaluate(IteratorType& aInOutBegin, const IteratorType& aEnd);
-
 		struct Component
 		{
 			enum class Type
 			{
 				Token,
 				Argument,
-				VariadicExpansion
+				VariadicExpansion,
+				Stringify,
+				Paste
 			};
 
 			std::optional<tokenizer::Token> myToken;
-			size_t myArgumentIndex;
+			size_t myArgumentIndex = 0; // only meaningful for Argument and Stringify
 			Type myType;
+			bool myHasLeadingSpace = false;
 		};
 
 		std::string myIdentifier;
+		size_t myId = 0;
+		bool myIsFunctionLike = false;
 		bool myHasVariadic = false;
 		size_t myArguments = 0;
 		std::vector<Component> myComponents;
+
+		std::optional<CachedExpansion> myCachedExpansion;
+		std::unordered_map<std::string, CachedExpansion, StringHash, std::equal_to<>> myCachedInvocations;
+	};
+
+	// Buffers owned by one nesting depth of Expand, they are cleared but never freed so expanding does not allocate once warm
+	struct ExpansionScratch
+	{
+		std::vector<ExpansionSpan> myPending;
+		std::vector<ExpansionToken> myArgumentTokens;
+		std::vector<size_t> myArgumentBounds;
+		std::vector<ExpansionSpan> myArguments;
+		std::vector<std::optional<ExpansionSpan>> myExpandedArguments;
+		std::vector<ExpansionToken> myExpandedArgument;
+		std::vector<ExpansionToken> mySubstitution;
+		std::string myInvocationKey;
 	};
 
+public:
 	struct Context
 	{
-		std::unordered_map<std::string, Macro> myMacros;
+		std::unordered_map<std::string, Macro, StringHash, std::equal_to<>> myMacros;
+		size_t myMacroCounter = 0;
+
+		HideSets myHideSets;
+		TokenArena<ExpansionToken> myArena;
+		TokenArena<char> mySpellings;
+		std::deque<ExpansionScratch> myScratch;
+		size_t myDepth = 0;
+
+		std::vector<ExpansionToken> myLine;
+		std::vector<ExpansionToken> myResult;
+
+		std::set<std::filesystem::path> myOnceFiles;
+		std::vector<std::filesystem::path> myIncludedFiles; // what a snapshot of this context or a translation unit depends on
+		DependencyScanner* myScanner = nullptr; // when set includes only run their directives through the scanner
+
+		// macro name -> macros whose cached expansions looked it up
+		std::unordered_map<std::string, std::vector<std::string>, StringHash, std::equal_to<>> myCacheDependents;
+		std::vector<std::string_view> myDependencies;
+		size_t myRecording = 0;
+		size_t myExpansionErrors = 0;
 	};
+
+private:
 	
 	template<std::ranges::contiguous_range TokenCollection>
-	static std::vector<tokenizer::Token> TranslateTokenRange(TokenCollection aTokens);
+	static void TranslateTokenRange(const TokenCollection& aTokens, tokenizer::TokenStream& aOutTokens);
+
+	template<std::ranges::contiguous_range TokenCollection>
+	static ExpansionSpan ToExpansionTokens(TokenCollection& aTokens);
+
+	// returns true if the input ran out in the middle of a macro invocation
+	static bool Expand(ExpansionSpan aInput, std::vector<ExpansionToken>& aOut, bool aKeepDefinedOperands);
+	static ExpansionSpan Substitute(const Macro& aMacro, std::span<const ExpansionSpan> aArguments, HideSets::Id aHideSet, ExpansionScratch& aScratch);
+	static Macro* FindMacro(const ExpansionToken& aToken);
+	static ExpansionToken Stringify(const tokenizer::Token& aLocation, ExpansionSpan aArgument);
+	static std::optional<ExpansionToken> Paste(const tokenizer::Token& aLocation, const ExpansionToken& aLeft, const ExpansionToken& aRight);
+	static bool HasLeadingSpace(const tokenizer::Token& aPrevious, const tokenizer::Token& aToken);
+	static void EmitExpansionError(const std::string& aMessage, const tokenizer::Token& aToken);
+
+	static void FillCache(CachedExpansion& aOutEntry, const Macro& aMacro, std::span<const ExpansionSpan> aArguments, HideSets::Id aHideSet, ExpansionScratch& aScratch, ExpansionSpan aArgumentTokens);
+	static void AppendCached(const CachedExpansion& aEntry, ExpansionSpan aArgumentTokens, std::vector<ExpansionToken>& aOut);
+	static void InvalidateCachesUsing(std::string_view aMacro);
+
+	static ExpansionScratch& PushScratch();
+	static void PopScratch();
 	
 	static void IncludeFile(tokenizer::TokenStream& aOutTokens, const std::vector<tokenizer::Token>& aTokens, std::vector<tokenizer::Token>::const_iterator aIncludeIt);
 
@@ -78,13 +211,16 @@ private:
 	
 	template<std::ranges::contiguous_range TokenCollection>
 	static PreprocessorNumber EvalutateSequence(TokenCollection aTokens);
-	
+
 	template<std::forward_iterator IteratorType>
-	static IteratorType FindMatchingEndParen(IteratorType aBegin, IteratorType aEnd);
+	class ExpressionEvaluator;
 
 	template<std::ranges::contiguous_range TokenCollection>
 	static void Define(TokenCollection aTokens);
 
+	static void Undefine(const tokenizer::Token& aIdentifier);
+
 
-	static Context myContext;
-};
+	static thread_local Context myThreadContext;
+	static thread_local Context* myContext;
+};
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include <catch2/catch_all.hpp>
+
+#include <thread>
+
+#include "common/CompilerContext.h"
+#include "precompiler/precompiler.h"
+#include "tokenizer/tokenizer.h"
+
+#include "PreprocessHelpers.h"
+
+namespace
+{
+	const std::filesystem::path File = "test/precompiler/configurations/1_configurations.txt";
+
+	std::vector<std::string> Preprocess()
+	{
+		return Spellings(PreprocessTokens(File));
+	}
+}
+
+TEST_CASE("precompiler::concurrency::threads", "")
+{
+	const std::vector<std::pair<std::string, std::vector<std::string>>> cases = {
+		{ "MODE=2,VALUE=x", { "shared", "two", "x" } },
+		{ "EXTRA,VALUE=(1+2)", { "extra", "shared", "other", "(", "1", "+", "2", ")" } },
+		{ "", { "shared", "other", "VALUE" } }
+	};
+
+	std::vector<std::vector<std::string>> results(cases.size() * 4);
+	{
+		std::vector<std::jthread> threads;
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			threads.emplace_back([&cases, &results, i]()
+				{
+					for (size_t repeat = 0; repeat < 8; repeat++)
+					{
+						Precompiler::ResetContext();
+						Precompiler::Predefine(cases[i % cases.size()].first);
+						results[i] = Preprocess();
+					}
+				});
+		}
+	}
+
+	for (size_t i = 0; i < results.size(); i++)
+		REQUIRE(results[i] == cases[i % cases.size()].second);
+	REQUIRE(!CompilerContext::HasErrors());
+}
+
+TEST_CASE("precompiler::concurrency::handed_between_threads", "")
+{
+	Precompiler::Context context;
+	CompilerContext::State state;
+
+	std::thread([&context]()
+		{
+			Precompiler::Scope scope(context);
+			Precompiler::Predefine("MODE=2,VALUE=y");
+		}).join();
+
+	// the thread that made the macros is gone, another finishes the translation unit with them
+	std::vector<std::string> result;
+	std::thread([&context, &state, &result]()
+		{
+			Precompiler::Scope scope(context);
+			CompilerContext::Scope compilerScope(state);
+			result = Preprocess();
+		}).join();
+
+	REQUIRE(result == std::vector<std::string>{ "shared", "two", "y" });
+	REQUIRE(state.myFileStack.empty());
+
+	// this thread's own context never saw them
+	Precompiler::ResetContext();
+	REQUIRE(Preprocess() == std::vector<std::string>{ "shared", "other", "VALUE" });
+}
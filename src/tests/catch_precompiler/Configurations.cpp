@@ -0,0 +1,80 @@
+#include <catch2/catch_all.hpp>
+
+#include <fstream>
+#include <sstream>
+
+#include "common/CompilerContext.h"
+#include "precompiler/precompiler.h"
+#include "tokenizer/tokenizer.h"
+
+#include "PreprocessHelpers.h"
+
+TEST_CASE("precompiler::configurations::predefine", "")
+{
+	std::filesystem::path file = "test/precompiler/configurations/1_configurations.txt";
+
+	tokenizer::LineCache lineCache;
+
+	REQUIRE(PreprocessFile(file, "MODE=2,VALUE=x") == std::vector<std::string>{ "shared", "two", "x" });
+	REQUIRE(PreprocessFile(file, "EXTRA,VALUE=(1+2)") == std::vector<std::string>{ "extra", "shared", "other", "(", "1", "+", "2", ")" });
+	REQUIRE(PreprocessFile(file, "") == std::vector<std::string>{ "shared", "other", "VALUE" });
+	REQUIRE(!CompilerContext::HasErrors());
+}
+
+TEST_CASE("precompiler::configurations::line_cache", "")
+{
+	std::filesystem::path file = std::filesystem::temp_directory_path() / "fisk_line_cache.txt";
+	std::ofstream(file) << "#ifdef A\na\n#endif\nb\n";
+
+	{
+		tokenizer::LineCache lineCache;
+		REQUIRE(PreprocessFile(file, "A") == std::vector<std::string>{ "a", "b" });
+		REQUIRE(PreprocessFile(file, "") == std::vector<std::string>{ "b" });
+
+		// a changed file is read again
+		std::ofstream(file) << "c\n";
+		REQUIRE(PreprocessFile(file, "") == std::vector<std::string>{ "c" });
+	}
+
+	REQUIRE(PreprocessFile(file, "A") == std::vector<std::string>{ "c" });
+	REQUIRE(!CompilerContext::HasErrors());
+
+	std::filesystem::remove(file);
+}
+
+TEST_CASE("precompiler::configurations::line_cache_diagnostics", "")
+{
+	std::filesystem::path file = std::filesystem::temp_directory_path() / "fisk_line_cache_diagnostics.txt";
+	std::ofstream(file) << "// note \\";
+
+	tokenizer::LineCache lineCache;
+
+	std::vector<std::string> outputs;
+	std::vector<size_t> errors;
+	for (size_t i = 0; i < 2; i++)
+	{
+		std::ostringstream output;
+		CompilerContext::Redirect redirect(output);
+
+		size_t before = CompilerContext::GetErrorCount();
+		PreprocessFile(file);
+		errors.push_back(CompilerContext::GetErrorCount() - before);
+		outputs.push_back(std::move(output).str());
+	}
+
+	// the second time the file comes out of the cache, with the same errors as when it was read
+	REQUIRE(errors[0] == 1);
+	REQUIRE(errors[1] == 1);
+	REQUIRE(outputs[0].find("concatination at end of file") != std::string::npos);
+	REQUIRE(outputs[1] == outputs[0]);
+
+	{
+		CompilerContext::IgnoreHandle ignore = CompilerContext::IgnoreErrors();
+		size_t before = CompilerContext::GetErrorCount();
+		PreprocessFile(file);
+		REQUIRE(CompilerContext::GetErrorCount() == before);
+	}
+
+	CompilerContext::ClearErrors();
+	std::filesystem::remove(file);
+}
@@ -0,0 +1,45 @@
+#include <catch2/catch_all.hpp>
+
+#include "common/CompilerContext.h"
+#include "precompiler/DependencyScanner.h"
+
+namespace
+{
+	std::vector<std::string> FileNames(const DependencyScanner::Dependencies& aDependencies)
+	{
+		std::vector<std::string> out;
+		for (const std::filesystem::path& dependency : aDependencies)
+			out.push_back(dependency.filename().string());
+		return out;
+	}
+}
+
+TEST_CASE("precompiler::dependency_scanner::scan", "")
+{
+	std::vector<std::filesystem::path> files = {
+		"test/precompiler/dependency_scanner/1_skipped.txt",
+		"test/precompiler/dependency_scanner/2_guarded.txt"
+	};
+
+	DependencyScanner scanner;
+	std::vector<DependencyScanner::Dependencies> dependencies = scanner.Scan(files, {}, {}, 2);
+
+	REQUIRE(dependencies.size() == 2);
+	REQUIRE(FileNames(dependencies[0]) == std::vector<std::string>{ "1_skipped.txt", "guarded.txt", "selected.txt" });
+	REQUIRE(FileNames(dependencies[1]) == std::vector<std::string>{ "2_guarded.txt", "selected.txt", "guarded.txt" });
+	REQUIRE(!CompilerContext::HasErrors());
+
+	REQUIRE(DependencyScanner::ToMake({ "a b.cpp" }, { { "a b.cpp", "c.h" } }) == "a\\ b.o: \\\n  a\\ b.cpp \\\n  c.h\n");
+}
+
+TEST_CASE("precompiler::dependency_scanner::configurations", "")
+{
+	std::vector<std::filesystem::path> files = { "test/precompiler/dependency_scanner/3_configured.txt" };
+
+	DependencyScanner scanner;
+	REQUIRE(FileNames(scanner.Scan(files, {}, { "MODE=2" }, 1)[0]) == std::vector<std::string>{ "3_configured.txt", "selected.txt" });
+
+	// what every configuration included, in the order it was first included
+	REQUIRE(FileNames(scanner.Scan(files, {}, { "MODE=1", "MODE=2" }, 1)[0]) == std::vector<std::string>{ "3_configured.txt", "guarded.txt", "selected.txt" });
+	REQUIRE(!CompilerContext::HasErrors());
+}
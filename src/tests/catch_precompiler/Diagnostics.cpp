@@ -0,0 +1,91 @@
+#include <catch2/catch_all.hpp>
+
+#include "common/CompilerContext.h"
+#include "common/Diagnostics.h"
+
+namespace
+{
+	Diagnostic MakeDiagnostic()
+	{
+		Diagnostic diagnostic;
+		diagnostic.mySeverity = Diagnostic::Severity::Warning;
+		diagnostic.myMessage = "Unused \"value\"";
+		diagnostic.myFile = "dir/file.cpp";
+		diagnostic.myLine = 2;
+		diagnostic.myColumn = 5;
+		diagnostic.mySize = 3;
+		diagnostic.mySourceLine = "\tint abc;\t";
+		return diagnostic;
+	}
+}
+
+TEST_CASE("common::diagnostics::text", "")
+{
+	Diagnostic diagnostic = MakeDiagnostic();
+	Diagnostics::Text text = Diagnostics::ToText(diagnostic);
+
+	// the tab before the column widens the line by one, the one after it does not move the marker
+	REQUIRE(text.myText == "WARNING Unused \"value\" [in file " + diagnostic.myFile.string() + ":2:5] \n\\tint abc;\\t\n      ^~~\n\n");
+	REQUIRE(text.myText.substr(0, text.myLabelEnd) == "WARNING");
+	REQUIRE(text.myText.substr(text.myMarkerBegin, text.myMarkerEnd - text.myMarkerBegin) == "^~~");
+
+	diagnostic.myColumn = Diagnostic::EndOfLine;
+	diagnostic.mySourceLine.reset();
+	REQUIRE(Diagnostics::ToText(diagnostic).myText == "WARNING Unused \"value\" [in file " + diagnostic.myFile.string() + ":2:eol] \n");
+}
+
+TEST_CASE("common::diagnostics::json_and_sarif", "")
+{
+	std::vector<Diagnostic> diagnostics = { MakeDiagnostic() };
+	diagnostics.push_back(MakeDiagnostic());
+	diagnostics.back().mySeverity = Diagnostic::Severity::Error;
+	diagnostics.back().myColumn = Diagnostic::EndOfLine;
+
+	std::string json = Diagnostics::ToJson(diagnostics);
+	REQUIRE(json.find("{ \"severity\": \"warning\", \"message\": \"Unused \\\"value\\\"\", \"file\": \"dir/file.cpp\", \"line\": 2, \"column\": 5, \"length\": 3 }") != std::string::npos);
+	REQUIRE(json.find("\"severity\": \"error\"") != std::string::npos);
+	REQUIRE(json.find("\"column\": null") != std::string::npos);
+
+	std::string sarif = Diagnostics::ToSarif(diagnostics);
+	REQUIRE(sarif.find("\"version\": \"2.1.0\"") != std::string::npos);
+	REQUIRE(sarif.find("\"region\": { \"startLine\": 3, \"startColumn\": 6, \"endColumn\": 9 }") != std::string::npos);
+	REQUIRE(sarif.find("\"region\": { \"startLine\": 3 }") != std::string::npos);
+	REQUIRE(sarif.find("\"level\": \"error\"") != std::string::npos);
+}
+
+TEST_CASE("common::diagnostics::collect", "")
+{
+	std::vector<Diagnostic> collected;
+	{
+		CompilerContext::Collect collect(collected);
+		CompilerContext::SetPrintContext(std::make_shared<const std::vector<std::string>>(std::vector<std::string>{ "first", "second line" }));
+		CompilerContext::EmitWarning("Something", "collected.cpp", 7, 1, 4);
+	}
+
+	REQUIRE(collected.size() == 1);
+	REQUIRE(collected[0].mySeverity == Diagnostic::Severity::Warning);
+	REQUIRE(collected[0].myFile == "collected.cpp");
+	REQUIRE(collected[0].myColumn == 7);
+	REQUIRE(collected[0].mySourceLine == "second line");
+
+	CompilerContext::SetPrintContext({});
+}
+
+TEST_CASE("common::diagnostics::print_context_is_shared", "")
+{
+	CompilerContext::Source includer = std::make_shared<const std::vector<std::string>>(std::vector<std::string>{ "#include \"included.h\"" });
+	CompilerContext::Source included = std::make_shared<const std::vector<std::string>>(std::vector<std::string>{ "int a;" });
+
+	CompilerContext::SetPrintContext(includer);
+	CompilerContext::PushFile("included.h");
+	CompilerContext::SetPrintContext(included);
+	REQUIRE(&CompilerContext::GetPrintContext() == included.get());
+	REQUIRE(includer.use_count() == 2); // held by the stack, not copied onto it
+
+	CompilerContext::PopFile();
+	REQUIRE(&CompilerContext::GetPrintContext() == includer.get());
+	REQUIRE(included.use_count() == 1);
+
+	CompilerContext::SetPrintContext({});
+	REQUIRE(CompilerContext::GetPrintContext().empty());
+}
@@ -0,0 +1,67 @@
+#include <catch2/catch_all.hpp>
+
+#include "tools/DiskCache.h"
+#include "tools/Hash.h"
+
+namespace
+{
+	std::filesystem::path FreshDirectory()
+	{
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "fisk_disk_cache_test";
+		std::filesystem::remove_all(directory);
+		return directory;
+	}
+}
+
+TEST_CASE("tools::hash::xxh64", "")
+{
+	// reference values of XXH64 with seed 0
+	Hash empty;
+	REQUIRE(empty.Get() == 0xef46db3751d8e999ull);
+
+	Hash whole;
+	whole.Add("Nobody inspects the spammish repetition");
+	REQUIRE(whole.Get() == 0xfbcea83c8a378bf1ull);
+
+	Hash pieces;
+	pieces.Add("Nobody inspects");
+	pieces.Add(" the spammish ");
+	pieces.Add("repetition");
+	REQUIRE(pieces.Get() == whole.Get());
+}
+
+TEST_CASE("tools::disk_cache::round_trip", "")
+{
+	std::filesystem::path directory = FreshDirectory();
+	DiskCache cache(directory, 1024 * 1024);
+
+	REQUIRE(!cache.Get(1));
+	REQUIRE(cache.Put(1, std::string("with\0nul", 8)));
+	REQUIRE(cache.Get(1) == std::string("with\0nul", 8));
+
+	// another process sharing the directory sees the same entry
+	DiskCache other(directory, 1024 * 1024);
+	REQUIRE(other.Get(1) == std::string("with\0nul", 8));
+	REQUIRE(!other.Get(2));
+
+	std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("tools::disk_cache::evicts_least_recently_used", "")
+{
+	std::filesystem::path directory = FreshDirectory();
+	DiskCache cache(directory, 300);
+
+	std::string data(100, 'x');
+	REQUIRE(cache.Put(1, data));
+	REQUIRE(cache.Put(2, data));
+	REQUIRE(cache.Get(1));
+
+	REQUIRE(cache.Put(3, data));
+
+	REQUIRE(cache.Get(1));
+	REQUIRE(!cache.Get(2));
+	REQUIRE(cache.Get(3));
+
+	std::filesystem::remove_all(directory);
+}
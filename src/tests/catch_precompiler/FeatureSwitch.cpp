@@ -0,0 +1,22 @@
+#include <catch2/catch_all.hpp>
+
+#include "common/FeatureSwitch.h"
+
+TEST_CASE("common::feature_switch::collections", "")
+{
+	FeatureSwitch switches;
+	REQUIRE(switches.IsEnabled(Warning::if_contamitaion));
+	REQUIRE(switches.IsEnabled(Warning::include_guard));
+
+	REQUIRE(switches.Disable("precompiler"));
+	REQUIRE(!switches.IsEnabled(Warning::if_contamitaion));
+	REQUIRE(!switches.IsEnabled(Warning::include_guard));
+
+	REQUIRE(switches.Enable("if_contamitaion"));
+	REQUIRE(switches.IsEnabled(Warning::if_contamitaion));
+	REQUIRE(!switches.IsEnabled(Warning::include_guard));
+
+	REQUIRE(!switches.Enable("no_such_warning"));
+	REQUIRE(FeatureSwitch::Find("include_guard") == Warning::include_guard);
+	REQUIRE(!FeatureSwitch::Find("precompiler"));
+}
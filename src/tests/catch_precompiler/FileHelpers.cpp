@@ -0,0 +1,31 @@
+#include <catch2/catch_all.hpp>
+
+#include <fstream>
+
+#include "tools/fileHelpers.h"
+
+TEST_CASE("tools::file_helpers::changed_dependencies", "")
+{
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "fisk_file_helpers_test";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory / "include");
+	std::ofstream(directory / "include" / "header.h") << "#pragma once\n";
+	std::ofstream(directory / "main.cpp") << "#include \"include/header.h\"\n";
+
+	// how the compiler found the files and how the watcher reports them differ in spelling
+	std::vector<std::string> dependencies = { FileKey(directory / "main.cpp"), FileKey(directory / "." / "include" / ".." / "include" / "header.h") };
+
+	REQUIRE(IsAnyChanged(dependencies, { FileKey(directory / "include" / "header.h") }));
+	REQUIRE(IsAnyChanged(dependencies, { FileKey(directory / "other.h"), FileKey(directory / "main.cpp") }));
+	REQUIRE(!IsAnyChanged(dependencies, { FileKey(directory / "other.h") }));
+	REQUIRE(!IsAnyChanged(dependencies, { FileKey(directory / "header.h") }));
+	REQUIRE(!IsAnyChanged(dependencies, {}));
+	REQUIRE(!IsAnyChanged({}, { FileKey(directory / "main.cpp") }));
+
+	// a file that is not there yet is still spelled the same way once it is
+	std::string created = FileKey(directory / "include" / ".." / "created.h");
+	std::ofstream(directory / "created.h") << "\n";
+	REQUIRE(created == FileKey(directory / "created.h"));
+
+	std::filesystem::remove_all(directory);
+}
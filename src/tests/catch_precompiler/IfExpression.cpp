@@ -0,0 +1,43 @@
+
+#include <catch2/catch_all.hpp>
+
+#include "common/CompilerContext.h"
+#include "precompiler/precompiler.h"
+#include "tokenizer/tokenizer.h"
+
+#include "PreprocessHelpers.h"
+
+TEST_CASE("precompiler::if_expression::precedence", "")
+{
+	REQUIRE(PreprocessFile("test/precompiler/if_expression/1_precedence.txt") == std::vector<std::string>
+		{
+			"pass_multiplication",
+			"pass_shift",
+			"pass_bitwise",
+			"pass_logical",
+			"pass_unary",
+			"pass_literals"
+		});
+}
+
+TEST_CASE("precompiler::if_expression::conditional", "")
+{
+	REQUIRE(PreprocessFile("test/precompiler/if_expression/2_conditional.txt") == std::vector<std::string>
+		{
+			"pass_ternary",
+			"pass_short_circuit",
+			"pass_short_circuit_or"
+		});
+	REQUIRE(!CompilerContext::HasErrors());
+}
+
+TEST_CASE("precompiler::if_expression::defined", "")
+{
+	REQUIRE(PreprocessFile("test/precompiler/if_expression/3_defined.txt") == std::vector<std::string>
+		{
+			"pass_defined",
+			"pass_undefined_is_zero",
+			"pass_skipped_group"
+		});
+	REQUIRE(!CompilerContext::HasErrors());
+}
@@ -0,0 +1,53 @@
+#include <catch2/catch_all.hpp>
+
+#include "common/CompilerContext.h"
+#include "common/IncludeReport.h"
+#include "precompiler/precompiler.h"
+#include "tokenizer/tokenizer.h"
+
+namespace
+{
+	std::string FindRow(const std::string& aCsv, const std::string& aFileName)
+	{
+		size_t at = aCsv.find(aFileName + "\",");
+		if (at == std::string::npos)
+			return "";
+
+		size_t begin = at + aFileName.size() + 2;
+		return aCsv.substr(begin, aCsv.find('\n', begin) - begin);
+	}
+
+	// included, skipped, then counts after the two timings
+	std::string WithoutTimings(const std::string& aRow)
+	{
+		std::vector<std::string> columns;
+		size_t at = 0;
+		while (true)
+		{
+			size_t next = aRow.find(',', at);
+			columns.push_back(aRow.substr(at, next - at));
+			if (next == std::string::npos)
+				break;
+			at = next + 1;
+		}
+
+		return columns.size() == 7 ? columns[0] + "," + columns[1] + "," + columns[4] + "," + columns[5] + "," + columns[6] : aRow;
+	}
+}
+
+TEST_CASE("precompiler::include_report::counts", "")
+{
+	IncludeReport::Enable();
+
+	std::filesystem::path file = "test/precompiler/include_report/1_report.txt";
+	Precompiler::ResetContext();
+	CompilerContext::PushFile(file);
+	tokenizer::Tokenize(file);
+	CompilerContext::PopFile();
+
+	REQUIRE(!CompilerContext::HasErrors());
+
+	std::string csv = IncludeReport::ToCsv();
+	REQUIRE(WithoutTimings(FindRow(csv, "/1_report.txt")) == "1,0,70,2,1");
+	REQUIRE(WithoutTimings(FindRow(csv, "/once.txt")) == "1,1,39,3,3");
+}
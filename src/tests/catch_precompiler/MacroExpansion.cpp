@@ -0,0 +1,124 @@
+#include <catch2/catch_all.hpp>
+
+#include "common/CompilerContext.h"
+#include "precompiler/precompiler.h"
+#include "tokenizer/tokenizer.h"
+
+#include "PreprocessHelpers.h"
+
+TEST_CASE("precompiler::macro_expansion::rescan", "")
+{
+	REQUIRE(PreprocessFile("test/precompiler/macro_expansion/1_rescan.txt") == std::vector<std::string>
+		{
+			"1", "(", "value", ")",
+			"X", "+", "1",
+			"SELF", "(", "0", "+", "1", ")"
+		});
+	REQUIRE(!CompilerContext::HasErrors());
+}
+
+TEST_CASE("precompiler::macro_expansion::function_like", "")
+{
+	REQUIRE(PreprocessFile("test/precompiler/macro_expansion/2_function_like.txt") == std::vector<std::string>
+		{
+			"2", "*", "9", "*", "g",
+			"1", "+", "2", "+", "(", "3", ",", "4", ")", "none", "NONE",
+			"print", "(", "\"a\"", ",", "1", ",", "2", ")"
+		});
+	REQUIRE(!CompilerContext::HasErrors());
+}
+
+TEST_CASE("precompiler::macro_expansion::bad_arguments", "")
+{
+	CompilerContext::IgnoreHandle ignore = CompilerContext::IgnoreErrors();
+
+	REQUIRE(PreprocessFile("test/precompiler/macro_expansion/3_bad_arguments.txt").empty());
+}
+
+TEST_CASE("precompiler::macro_expansion::bad_definition", "")
+{
+	size_t errors = CompilerContext::GetErrorCount();
+
+	// nothing of a definition that is wrong is kept, not even over an earlier one
+	REQUIRE(PreprocessFile("test/precompiler/macro_expansion/10_bad_definition.txt") == std::vector<std::string>
+		{
+			"STR", "(", "1", ")", "TAIL", "(", "2", ")", "HEAD", "ARGS", "(", "3", ")", "1"
+		});
+	REQUIRE(CompilerContext::GetErrorCount() - errors == 5);
+
+	CompilerContext::ClearErrors();
+}
+
+TEST_CASE("precompiler::macro_expansion::stringify", "")
+{
+	REQUIRE(PreprocessFile("test/precompiler/macro_expansion/4_stringify.txt") == std::vector<std::string>
+		{
+			"\"VALUE\"", "\"42\"",
+			"\"a +b\"", "\"\"", "\"\\\"quote\\\\n\\\" 'c'\"",
+			"\"1, 2,3\""
+		});
+	REQUIRE(!CompilerContext::HasErrors());
+}
+
+TEST_CASE("precompiler::macro_expansion::paste", "")
+{
+	REQUIRE(PreprocessFile("test/precompiler/macro_expansion/5_paste.txt") == std::vector<std::string>
+		{
+			"xy", "VALUE1", "421", "y", "x", "+=",
+			"123", "z",
+			"pasted_macro",
+			"first_index", ",", "second_index", ",",
+			"elseif", "while"
+		});
+	REQUIRE(!CompilerContext::HasErrors());
+}
+
+TEST_CASE("precompiler::macro_expansion::bad_paste", "")
+{
+	CompilerContext::IgnoreHandle ignore = CompilerContext::IgnoreErrors();
+
+	REQUIRE(PreprocessFile("test/precompiler/macro_expansion/6_bad_paste.txt") == std::vector<std::string>
+		{
+			"+", "-"
+		});
+}
+
+TEST_CASE("precompiler::macro_expansion::cache_invalidation", "")
+{
+	REQUIRE(PreprocessFile("test/precompiler/macro_expansion/7_cache.txt") == std::vector<std::string>
+		{
+			"1", "+", "C",
+			"1", "+", "3",
+			"B", "+", "3",
+			"2", "+", "3",
+			"A",
+			"redefined"
+		});
+}
+
+TEST_CASE("precompiler::macro_expansion::cache_reuse", "")
+{
+	REQUIRE(PreprocessFile("test/precompiler/macro_expansion/8_cache_synthesized.txt") == std::vector<std::string>
+		{
+			"xy", "\"hi there\"",
+			"xy", "\"hi there\"",
+			"2", "+", "1", "f"
+		});
+}
+
+TEST_CASE("precompiler::macro_expansion::invocation_cache", "")
+{
+	const char* argv[] = { "catch_precompiler", "-p:macro_cache" };
+	CompilerContext::ParseCommandLine(2, const_cast<char**>(argv));
+
+	REQUIRE(PreprocessFile("test/precompiler/macro_expansion/9_invocation_cache.txt") == std::vector<std::string>
+		{
+			"1", "+", "2", "1", "+", "2", "1", "+", "3",
+			"first_index", ",", "second_index", ",",
+			"first_index", ",", "second_index", ",",
+			"\"a\"", "\"a\"",
+			"2", "*", "9", "*", "g",
+			"one",
+			"two", "three"
+		});
+}
@@ -0,0 +1,43 @@
+#include <catch2/catch_all.hpp>
+
+#include "common/CompilerContext.h"
+#include "common/MacroStatistics.h"
+#include "precompiler/precompiler.h"
+#include "tokenizer/tokenizer.h"
+
+namespace
+{
+	// invocations, output tokens, tokens per invocation and depth, the timing is left out
+	std::string FindRow(const std::string& aCsv, const std::string& aMacro)
+	{
+		size_t at = aCsv.find("\n" + aMacro + ",");
+		if (at == std::string::npos)
+			return "";
+
+		size_t begin = at + aMacro.size() + 2;
+		size_t end = aCsv.rfind(',', aCsv.find('\n', begin));
+		return aCsv.substr(begin, end - begin);
+	}
+}
+
+TEST_CASE("precompiler::macro_statistics::counts", "")
+{
+	MacroStatistics::Enable();
+
+	std::filesystem::path file = "test/precompiler/macro_statistics/1_statistics.txt";
+	Precompiler::ResetContext();
+	CompilerContext::PushFile(file);
+	tokenizer::Tokenize(file);
+	CompilerContext::PopFile();
+
+	REQUIRE(!CompilerContext::HasErrors());
+
+	std::string csv = MacroStatistics::ToCsv(-1);
+	REQUIRE(FindRow(csv, "TWICE") == "2,14,7.000,1");
+	REQUIRE(FindRow(csv, "PAIR") == "2,6,3.000,2");
+	REQUIRE(FindRow(csv, "ONE") == "3,3,1.000,2");
+
+	std::string top = MacroStatistics::ToCsv(1);
+	REQUIRE(FindRow(top, "TWICE") != "");
+	REQUIRE(FindRow(top, "PAIR") == "");
+}
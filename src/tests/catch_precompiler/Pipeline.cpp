@@ -0,0 +1,125 @@
+#include <catch2/catch_all.hpp>
+
+#include <fstream>
+#include <sstream>
+
+#include "common/CompilerContext.h"
+#include "precompiler/precompiler.h"
+#include "tokenizer/tokenizer.h"
+
+namespace
+{
+	struct Result
+	{
+		std::vector<std::string> myTokens;
+		std::vector<size_t> myLines;
+		std::string myOutput;
+		size_t myErrors;
+	};
+
+	Result Preprocess(const std::filesystem::path& aFile)
+	{
+		Result result;
+		std::ostringstream output;
+		CompilerContext::Redirect redirect(output);
+
+		Precompiler::ResetContext();
+		CompilerContext::PushFile(aFile);
+
+		size_t errors = CompilerContext::GetErrorCount();
+		for (const tokenizer::Token& token : tokenizer::Tokenize(aFile) | tokenizer::token_helpers::IsNotWhitespace)
+		{
+			result.myTokens.push_back(token.myRawText);
+			result.myLines.push_back(token.myLine);
+		}
+		result.myErrors = CompilerContext::GetErrorCount() - errors;
+
+		CompilerContext::PopFile();
+		result.myOutput = std::move(output).str();
+		return result;
+	}
+}
+
+TEST_CASE("tokenizer::pipeline::same_as_serial", "")
+{
+	std::filesystem::path file = std::filesystem::temp_directory_path() / "fisk_pipeline.txt";
+	{
+		// well past the size a file is pipelined at, with an invalid token somewhere in the middle
+		std::ofstream out(file);
+		out << "#define TWICE(x) x x\n";
+		for (size_t i = 0; i < 4000; i++)
+		{
+			out << "TWICE(line" << i << ") \"a string\" 0x" << i << "\n";
+			if (i == 2000)
+				out << "@\n";
+		}
+	}
+
+	Result serial;
+	{
+		CompilerContext::IgnoreHandle ignore = CompilerContext::IgnoreErrors();
+		serial = Preprocess(file);
+	}
+	Result unignoredSerial = Preprocess(file);
+
+	tokenizer::EnablePipeline();
+
+	Result pipelined;
+	{
+		CompilerContext::IgnoreHandle ignore = CompilerContext::IgnoreErrors();
+		pipelined = Preprocess(file);
+	}
+	Result unignoredPipelined = Preprocess(file);
+
+	REQUIRE(serial.myTokens.size() > 12000);
+	REQUIRE(pipelined.myTokens == serial.myTokens);
+	REQUIRE(pipelined.myLines == serial.myLines);
+	REQUIRE(pipelined.myOutput.empty());
+	REQUIRE(pipelined.myErrors == 0);
+
+	REQUIRE(unignoredSerial.myErrors == 1);
+	REQUIRE(unignoredPipelined.myErrors == 1);
+	REQUIRE(unignoredPipelined.myOutput == unignoredSerial.myOutput);
+
+	CompilerContext::ClearErrors();
+	std::filesystem::remove(file);
+}
+
+TEST_CASE("tokenizer::pipeline::structured_diagnostics", "")
+{
+	std::filesystem::path file = std::filesystem::temp_directory_path() / "fisk_pipeline_structured.txt";
+	{
+		std::ofstream out(file);
+		for (size_t i = 0; i < 8000; i++)
+		{
+			out << "line" << i << " \"a string\" 0x" << i << "\n";
+			if (i == 4000)
+				out << "@\n";
+		}
+	}
+
+	tokenizer::EnablePipeline();
+	Diagnostics::SetFormat(Diagnostics::Format::Json);
+
+	std::vector<Diagnostic> collected;
+	Result pipelined;
+	{
+		CompilerContext::Collect collect(collected);
+		pipelined = Preprocess(file);
+	}
+
+	// what the lexer thread found is collected by whoever preprocesses the file, not recorded for the whole run
+	std::string recorded = Diagnostics::TakeDocument();
+	Diagnostics::SetFormat(Diagnostics::Format::Text);
+
+	REQUIRE(pipelined.myErrors == 1);
+	REQUIRE(pipelined.myOutput.empty());
+	REQUIRE(collected.size() == 1);
+	REQUIRE(collected[0].mySeverity == Diagnostic::Severity::Error);
+	REQUIRE(collected[0].myFile == file);
+	REQUIRE(collected[0].myLine == 4001);
+	REQUIRE(recorded == Diagnostics::ToJson({}));
+
+	CompilerContext::ClearErrors();
+	std::filesystem::remove(file);
+}
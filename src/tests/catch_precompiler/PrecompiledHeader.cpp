@@ -0,0 +1,106 @@
+#include <catch2/catch_all.hpp>
+
+#include <fstream>
+
+#include "common/CompilerContext.h"
+#include "precompiler/PrecompiledHeader.h"
+#include "precompiler/precompiler.h"
+#include "tokenizer/tokenizer.h"
+
+#include "PreprocessHelpers.h"
+
+namespace
+{
+	// A copy of the test files that can be modified without touching the originals
+	std::filesystem::path CopyTestFiles()
+	{
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "fisk_precompiled_header";
+		std::filesystem::remove_all(directory);
+		std::filesystem::copy("test/precompiler/precompiled_header", directory);
+		return directory;
+	}
+
+	std::string ReadBytes(const std::filesystem::path& aFile)
+	{
+		std::ifstream file(aFile, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+}
+
+TEST_CASE("precompiler::precompiled_header::round_trip", "")
+{
+	std::filesystem::path directory = CopyTestFiles();
+
+	Precompiler::ResetContext();
+	std::vector<tokenizer::Token> prelude = PreprocessTokens(directory / "prelude.txt");
+	REQUIRE(PrecompiledHeader::Write(directory / "prelude.pch", directory / "prelude.txt", "", prelude));
+
+	// nothing but the state of the preprocessor goes into the file, writing it again gives the same bytes
+	REQUIRE(PrecompiledHeader::Write(directory / "again.pch", directory / "prelude.txt", "", prelude));
+	REQUIRE(ReadBytes(directory / "prelude.pch") == ReadBytes(directory / "again.pch"));
+
+	PrecompiledHeader snapshot(directory / "prelude.pch");
+	REQUIRE(snapshot.GetProblem().empty());
+	REQUIRE(snapshot.GetPrelude() == directory / "prelude.txt");
+
+	snapshot.Apply();
+	REQUIRE(Spellings(snapshot.GetTokens()) == Spellings(prelude));
+
+	REQUIRE(Spellings(PreprocessTokens(directory / "main.txt")) == std::vector<std::string>
+		{
+			"myValue", "(", "(", "4", ")", "*", "(", "4", ")", ")"
+		});
+	REQUIRE(!CompilerContext::HasErrors());
+}
+
+TEST_CASE("precompiler::precompiled_header::stale", "")
+{
+	std::filesystem::path directory = CopyTestFiles();
+
+	Precompiler::ResetContext();
+	std::vector<tokenizer::Token> prelude = PreprocessTokens(directory / "prelude.txt");
+	REQUIRE(PrecompiledHeader::Write(directory / "prelude.pch", directory / "prelude.txt", "", prelude));
+
+	PrecompiledHeader opened(directory / "prelude.pch");
+	REQUIRE(opened.GetProblem().empty());
+	REQUIRE(!opened.HasChanged());
+
+	std::filesystem::path included = directory / "included.txt";
+	std::filesystem::last_write_time(included, std::filesystem::last_write_time(included) - std::chrono::hours(1));
+
+	// one that was opened before finds out when it is asked again
+	REQUIRE(opened.HasChanged());
+
+	PrecompiledHeader snapshot(directory / "prelude.pch");
+	REQUIRE(!snapshot.GetProblem().empty());
+	REQUIRE(snapshot.GetPrelude() == directory / "prelude.txt");
+}
+
+TEST_CASE("precompiler::precompiled_header::defines", "")
+{
+	std::filesystem::path directory = CopyTestFiles();
+
+	Precompiler::ResetContext();
+	Precompiler::Predefine("MODE=1");
+	std::vector<tokenizer::Token> prelude = PreprocessTokens(directory / "prelude.txt");
+	REQUIRE(PrecompiledHeader::Write(directory / "prelude.pch", directory / "prelude.txt", "MODE=1", prelude));
+
+	PrecompiledHeader same(directory / "prelude.pch", "MODE=1");
+	REQUIRE(same.GetProblem().empty());
+	REQUIRE(same.GetDefines() == "MODE=1");
+
+	// the prelude could have come out differently with other defines
+	PrecompiledHeader other(directory / "prelude.pch", "MODE=2");
+	REQUIRE(!other.GetProblem().empty());
+	REQUIRE(other.GetPrelude() == directory / "prelude.txt");
+
+	PrecompiledHeader none(directory / "prelude.pch");
+	REQUIRE(!none.GetProblem().empty());
+}
+
+TEST_CASE("precompiler::precompiled_header::not_a_snapshot", "")
+{
+	PrecompiledHeader snapshot("test/precompiler/precompiled_header/main.txt");
+	REQUIRE(!snapshot.GetProblem().empty());
+	REQUIRE(snapshot.GetPrelude().empty());
+}
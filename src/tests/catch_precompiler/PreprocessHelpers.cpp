@@ -0,0 +1,28 @@
+#include "PreprocessHelpers.h"
+
+#include "common/CompilerContext.h"
+#include "precompiler/precompiler.h"
+#include "tokenizer/tokenizer.h"
+
+std::vector<tokenizer::Token> PreprocessTokens(const std::filesystem::path& aFile)
+{
+	CompilerContext::PushFile(aFile);
+	std::vector<tokenizer::Token> tokens = tokenizer::Tokenize(aFile);
+	CompilerContext::PopFile();
+	return tokens;
+}
+
+std::vector<std::string> Spellings(const std::vector<tokenizer::Token>& aTokens)
+{
+	std::vector<std::string> out;
+	for (const tokenizer::Token& token : aTokens | tokenizer::token_helpers::IsNotWhitespace)
+		out.push_back(token.myRawText);
+	return out;
+}
+
+std::vector<std::string> PreprocessFile(const std::filesystem::path& aFile, std::string_view aDefines)
+{
+	Precompiler::ResetContext();
+	Precompiler::Predefine(aDefines);
+	return Spellings(PreprocessTokens(aFile));
+}
@@ -0,0 +1,20 @@
+#ifndef TESTS_CATCH_PRECOMPILER_PREPROCESS_HELPERS_H
+#define TESTS_CATCH_PRECOMPILER_PREPROCESS_HELPERS_H
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tokenizer/token.h"
+
+// Tokenizes aFile as the file being compiled, in whatever precompiler context the thread is in
+std::vector<tokenizer::Token> PreprocessTokens(const std::filesystem::path& aFile);
+
+// The spelling of every token that is not whitespace
+std::vector<std::string> Spellings(const std::vector<tokenizer::Token>& aTokens);
+
+// The spellings aFile preprocesses to in a fresh context, with aDefines predefined the way -p:config does
+std::vector<std::string> PreprocessFile(const std::filesystem::path& aFile, std::string_view aDefines = {});
+
+#endif
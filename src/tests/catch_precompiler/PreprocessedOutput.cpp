@@ -0,0 +1,40 @@
+#include <catch2/catch_all.hpp>
+
+#include <fstream>
+#include <sstream>
+
+#include "common/CompilerContext.h"
+#include "precompiler/PreprocessedOutput.h"
+#include "precompiler/precompiler.h"
+#include "tokenizer/tokenizer.h"
+
+TEST_CASE("precompiler::preprocessed_output::line_markers", "")
+{
+	std::filesystem::path file = "test/precompiler/preprocessed_output/1_line_markers.txt";
+	std::filesystem::path outPath = std::filesystem::temp_directory_path() / "fisk_preprocessed_output.i";
+
+	{
+		BufferedWriter writer(outPath, 16); // small enough that the buffer fills up several times
+		PreprocessedOutput output(writer);
+		tokenizer::TokenStream stream(output);
+
+		Precompiler::ResetContext();
+		CompilerContext::PushFile(file);
+		tokenizer::Tokenize(file, stream);
+		CompilerContext::PopFile();
+	}
+
+	std::stringstream written;
+	written << std::ifstream(outPath).rdbuf();
+
+	REQUIRE(written.str() ==
+		"# 2 \"test/precompiler/preprocessed_output/included.txt\"\n"
+		"int fromIncluded ;\n"
+		"# 4 \"test/precompiler/preprocessed_output/1_line_markers.txt\"\n"
+		"int a = - - 1 ;\n"
+		"\n"
+		"int b = b b ;\n"
+		"# 17 \"test/precompiler/preprocessed_output/1_line_markers.txt\"\n"
+		"int c ;\n");
+	REQUIRE(!CompilerContext::HasErrors());
+}
@@ -0,0 +1,45 @@
+#include <catch2/catch_all.hpp>
+
+#include "common/CompilerContext.h"
+#include "common/TimeTrace.h"
+#include "precompiler/precompiler.h"
+#include "tokenizer/tokenizer.h"
+
+#include <thread>
+
+TEST_CASE("common::time_trace::spans", "")
+{
+	TimeTrace::Enable();
+
+	std::filesystem::path file = "test/precompiler/include_report/1_report.txt";
+	Precompiler::ResetContext();
+	CompilerContext::PushFile(file);
+	tokenizer::Tokenize(file);
+	CompilerContext::PopFile();
+
+	std::thread([]()
+		{
+			TimeTrace::Span span("OnAnotherThread");
+		}).join();
+
+	{
+		TimeTrace::Span skipped("TooShort", "", std::chrono::hours(1));
+	}
+
+	std::string json = TimeTrace::ToJson();
+	REQUIRE(json.starts_with("{ \"displayTimeUnit\": \"ms\", \"traceEvents\": ["));
+	REQUIRE(json.find("\"name\": \"ReadWholeFile\"") != std::string::npos);
+	REQUIRE(json.find("\"name\": \"UniversalEscape\"") != std::string::npos);
+	REQUIRE(json.find("\"name\": \"Reduce\"") != std::string::npos);
+	REQUIRE(json.find("\"detail\": \"test/precompiler/include_report/once.txt\"") != std::string::npos);
+	REQUIRE(json.find("\"name\": \"IncludeFile\"") != std::string::npos);
+	REQUIRE(json.find("TooShort") == std::string::npos);
+
+	// the thread that ended handed its span over under a number of its own
+	size_t other = json.find("\"name\": \"OnAnotherThread\"");
+	REQUIRE(other != std::string::npos);
+	size_t reading = json.find("\"name\": \"ReadWholeFile\"");
+	std::string_view otherThread = std::string_view(json).substr(json.find("\"tid\"", other), 10);
+	std::string_view readingThread = std::string_view(json).substr(json.find("\"tid\"", reading), 10);
+	REQUIRE(otherThread != readingThread);
+}
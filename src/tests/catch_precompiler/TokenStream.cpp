@@ -0,0 +1,52 @@
+#include <catch2/catch_all.hpp>
+
+#include "tokenizer/tokenStream.h"
+
+namespace
+{
+	tokenizer::Token MakeToken(size_t aIndex)
+	{
+		return tokenizer::Token(tokenizer::Token::Type::Integer_literal, std::to_string(aIndex), aIndex, 0);
+	}
+}
+
+TEST_CASE("tokenizer::token_stream::rope", "")
+{
+	std::shared_ptr<std::vector<tokenizer::Token>> shared = std::make_shared<std::vector<tokenizer::Token>>();
+	for (size_t i = 0; i < 100; i++)
+		shared->push_back(MakeToken(i));
+
+	tokenizer::TokenStream stream;
+	stream.Splice(shared);
+	for (size_t i = 100; i < 10000; i++)
+		stream << MakeToken(i);
+	stream.Splice(shared);
+	stream << MakeToken(10000);
+
+	REQUIRE(stream.size() == 10101);
+	REQUIRE(&stream[5] == &(*shared)[5]); // spliced, not copied
+	REQUIRE(&stream[10005] == &(*shared)[5]);
+
+	size_t index = 0;
+	bool inOrder = true;
+	for (const tokenizer::Token& token : stream)
+	{
+		size_t expected = index < 10000 ? index : index < 10100 ? index - 10000 : 10000;
+		inOrder &= token.myLine == expected;
+		index++;
+	}
+	REQUIRE(inOrder);
+	REQUIRE(index == stream.size());
+
+	tokenizer::TokenStream::const_iterator it = stream.begin() + 5000;
+	REQUIRE(it->myLine == 5000);
+	REQUIRE((it - 4950)->myLine == 50);
+	REQUIRE(it[-4999].myLine == 1);
+	REQUIRE(stream.end() - it == 5101);
+	REQUIRE((stream.end() - 1)->myLine == 10000);
+
+	std::vector<tokenizer::Token> flat = std::move(stream).Get();
+	REQUIRE(flat.size() == 10101);
+	REQUIRE(flat[4096].myRawText == "4096");
+	REQUIRE(flat[10050].myRawText == "50");
+}
@@ -0,0 +1,48 @@
+#include <catch2/catch_all.hpp>
+
+#include "common/Trace.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("common::trace::keeps_the_order_of_each_thread", "")
+{
+	const size_t threadCount = 4;
+	const size_t lineCount = 10000; // more than a ring holds, so the writer has to keep up
+
+	std::ostringstream output;
+	std::streambuf* previous = std::cerr.rdbuf(output.rdbuf());
+	{
+		std::vector<std::thread> threads;
+		for (size_t thread = 0; thread < threadCount; thread++)
+		{
+			threads.emplace_back([thread]()
+				{
+					for (size_t line = 0; line < lineCount; line++)
+						Trace::Line() << thread << " " << line;
+				});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+
+		Trace::Flush();
+	}
+	std::cerr.rdbuf(previous);
+
+	std::vector<size_t> next(threadCount, 0);
+	std::istringstream lines(output.str());
+	size_t thread;
+	size_t line;
+	while (lines >> thread >> line)
+	{
+		REQUIRE(thread < threadCount);
+		REQUIRE(line == next[thread]);
+		next[thread]++;
+	}
+
+	for (size_t count : next)
+		REQUIRE(count == lineCount);
+}
@@ -0,0 +1,19 @@
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+
+#include "tools/WorkStealingPool.h"
+
+TEST_CASE("tools::work_stealing_pool::runs_every_task_once", "")
+{
+	for (size_t threads : { 1, 3, 16 })
+	{
+		std::vector<std::atomic<size_t>> runs(50);
+		WorkStealingPool::Run(runs.size(), threads, [&runs](size_t aTask) { runs[aTask]++; });
+
+		for (std::atomic<size_t>& count : runs)
+			REQUIRE(count == 1);
+	}
+
+	WorkStealingPool::Run(0, 4, [](size_t) { REQUIRE(false); });
+}
@@ -35,38 +35,51 @@ namespace tokenizer
 
 	bool Token::IsTextToken() const
 	{
-		return myRawText.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ") > 0 &&
-			myRawText.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789", 1) == std::string::npos;
+		return IsTextToken(myRawText);
 	}
 
 	size_t Token::EvaluateIntegral() const
+	{
+		return EvaluateIntegral(myRawText);
+	}
+
+	bool Token::IsTextToken(std::string_view aText)
+	{
+		return aText.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_") > 0 &&
+			aText.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789", 1) == std::string_view::npos;
+	}
+
+	size_t Token::EvaluateIntegral(std::string_view aText)
 	{
 		size_t base = 10;
 		size_t at = 0;
 
-		if(myRawText.starts_with("0"))
-		{
-			base = 8;
-			at = 1;
-		}
-		else if (myRawText.starts_with("0x") || myRawText.starts_with("0X"))
+		if (aText.starts_with("0x") || aText.starts_with("0X"))
 		{
 			base = 16;
 			at = 2;
 		}
-		else if (myRawText.starts_with("0b") || myRawText.starts_with("0B"))
+		else if (aText.starts_with("0b") || aText.starts_with("0B"))
 		{
 			base = 2;
 			at = 2;
 		}
+		else if(aText.starts_with("0"))
+		{
+			base = 8;
+			at = 1;
+		}
 
 		size_t total = 0;
-		for(size_t i = at; i < myRawText.size(); i++)
+		for(size_t i = at; i < aText.size(); i++)
 		{
-			char c = myRawText[i];
+			char c = aText[i];
 			if(c == '\'')
 				continue;
 
+			if (c == 'u' || c == 'U' || c == 'l' || c == 'L')
+				break; // integer-suffix
+
 			size_t current;
 			if(c >= '0' && c <= '9')
 			{
@@ -74,11 +87,11 @@ namespace tokenizer
 			}
 			else if(c >= 'A' && c <= 'F')
 			{
-				current = c - 'A' + 9;
+				current = c - 'A' + 10;
 			}
-			else if (c >= 'a' && c <= 'a')
+			else if (c >= 'a' && c <= 'f')
 			{
-				current = c - 'a' + 9;
+				current = c - 'a' + 10;
 			}
 			else
 				throw std::exception("bad int parse");
@@ -182,6 +182,9 @@ namespace tokenizer
 		bool IsTextToken() const;
 		size_t EvaluateIntegral() const;
 
+		static bool IsTextToken(std::string_view aText);
+		static size_t EvaluateIntegral(std::string_view aText);
+
 		static std::string	TypeToString(Type);
 
 		Type					myType;
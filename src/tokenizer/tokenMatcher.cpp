@@ -1,11 +1,15 @@
 #include "tokenMatcher.h"
 
+#include <algorithm>
+#include <mutex>
+
 #include "common/CompilerContext.h"
 
 namespace tokenizer
 {
 
 	std::vector<std::shared_ptr<TokenMatcher::RootPattern>> TokenMatcher::ourRootPatterns;
+	thread_local std::unordered_map<std::string, Token::Type, TokenMatcher::WordHash, std::equal_to<>> TokenMatcher::ourWords;
 
 	namespace patterns
 	{
@@ -370,7 +374,7 @@ namespace tokenizer
 		size_t column = 0;
 
 		bool hasIncludeDirective = false;
-		bool trimWhitespace = !!CompilerContext::GetFlag("p:no_whitespace");
+		bool trimWhitespace = CompilerContext::GetSwitches().myNoWhitespace;
 
 		while (!lineLeft.empty())
 		{
@@ -487,6 +491,53 @@ namespace tokenizer
 		}
 	}
 
+	std::optional<Token::Type> TokenMatcher::MatchSingle(std::string_view aText)
+	{
+		LoadPatterns();
+
+		if (aText.empty())
+			return {};
+
+		auto isNondigit = [](char aChar) { return (aChar >= 'a' && aChar <= 'z') || (aChar >= 'A' && aChar <= 'Z') || aChar == '_'; };
+		auto isDigit = [](char aChar) { return aChar >= '0' && aChar <= '9'; };
+
+		bool isWord = isNondigit(aText[0]) && std::ranges::all_of(aText, [&](char aChar) { return isNondigit(aChar) || isDigit(aChar); });
+		if (!isWord)
+			return MatchLongest(aText);
+
+		// pasting mostly builds identifiers and the same ones over and over, only the first sighting of a word goes through all the patterns
+		decltype(ourWords)::iterator it = ourWords.find(aText);
+		if (it != std::end(ourWords))
+			return it->second;
+
+		std::optional<Token::Type> type = MatchLongest(aText);
+		if (type)
+			ourWords.emplace(aText, *type);
+
+		return type;
+	}
+
+	std::optional<Token::Type> TokenMatcher::MatchLongest(std::string_view aText)
+	{
+		size_t longest = 0;
+		Token::Type resultingType = Token::Type::Invalid;
+
+		for (auto& pattern : ourRootPatterns)
+		{
+			auto [amount, type] = pattern->Match(aText);
+			if(amount > longest)
+			{
+				longest = amount;
+				resultingType = type;
+			}
+		}
+
+		if (longest != aText.length())
+			return {};
+
+		return resultingType;
+	}
+
 	std::string_view TokenMatcher::SplitView(std::string_view& aInOutLeft, size_t aAmount)
 	{
 		std::string_view out(aInOutLeft.begin(), aInOutLeft.begin() + aAmount);
@@ -498,9 +549,12 @@ namespace tokenizer
 
 	void TokenMatcher::LoadPatterns()
 	{
-		if(!ourRootPatterns.empty())
-			return;
+		static std::once_flag loaded;
+		std::call_once(loaded, &TokenMatcher::BuildPatterns);
+	}
 
+	void TokenMatcher::BuildPatterns()
+	{
 		using namespace pattern_literals;
 		using namespace pattern_combinations;
 		using namespace pattern_helpers;
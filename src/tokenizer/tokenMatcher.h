@@ -8,6 +8,7 @@
 #include <memory>
 #include <optional>
 #include <concepts>
+#include <functional>
 
 namespace tokenizer
 {
@@ -31,6 +32,12 @@ namespace tokenizer
 
 		static void MatchTokens(std::vector<Token>& aWrite,const std::string& aLine, Context& aContext);
 
+		// The type of aText if it lexes as exactly one token, used to re-lex the result of ## pasting
+		static std::optional<Token::Type> MatchSingle(std::string_view aText);
+
+		// Builds the patterns if no thread has yet, done up front by a process that forks so its children share them
+		static void LoadPatterns();
+
 		class Pattern;
 		typedef std::unordered_map<std::string, std::shared_ptr<Pattern>> PatternCollection;
 
@@ -90,14 +97,23 @@ namespace tokenizer
 		};
 
 
-		static void LoadPatterns();
+		static void BuildPatterns();
 
 		static PatternBuilder BuildPattern(Token::Type aType)
 		{
 			return PatternBuilder(aType, ourRootPatterns);
 		};
 
+		static std::optional<Token::Type> MatchLongest(std::string_view aText);
+
+		struct WordHash
+		{
+			using is_transparent = void;
+			size_t operator()(std::string_view aText) const { return std::hash<std::string_view>()(aText); }
+		};
+
 		static std::vector<std::shared_ptr<RootPattern>> ourRootPatterns;
+		static thread_local std::unordered_map<std::string, Token::Type, WordHash, std::equal_to<>> ourWords;
 	};
 } // tokenizer
 
@@ -1,22 +1,136 @@
 #include "tokenizer/tokenStream.h"
 
+#include <algorithm>
+
 namespace tokenizer
 {
-	std::vector<Token>& TokenStream::Get()&&
+	TokenStream::const_iterator::const_iterator(const TokenStream* aStream, size_t aIndex)
+		: myStream(aStream)
+		, mySegment(aStream->FindSegment(aIndex))
+		, myIndex(aIndex)
+	{
+		if (mySegment != aStream->mySegments.size())
+		{
+			const Segment& segment = aStream->mySegments[mySegment];
+			myToken = segment.myData + (aIndex - segment.myStart);
+		}
+	}
+
+	TokenStream::const_iterator& TokenStream::const_iterator::operator++()
+	{
+		myIndex++;
+		myToken++;
+
+		const Segment& segment = myStream->mySegments[mySegment];
+		if (myIndex == segment.myStart + segment.mySize)
+		{
+			mySegment++;
+			myToken = mySegment != myStream->mySegments.size() ? myStream->mySegments[mySegment].myData : nullptr;
+		}
+
+		return *this;
+	}
+
+	TokenStream::const_iterator& TokenStream::const_iterator::operator+=(difference_type aOffset)
+	{
+		size_t index = myIndex + aOffset;
+
+		if (mySegment != myStream->mySegments.size())
+		{
+			const Segment& segment = myStream->mySegments[mySegment];
+			if (index >= segment.myStart && index < segment.myStart + segment.mySize)
+			{
+				myIndex = index;
+				myToken = segment.myData + (index - segment.myStart);
+				return *this;
+			}
+		}
+
+		*this = const_iterator(myStream, index);
+		return *this;
+	}
+
+	TokenStream::TokenStream(TokenSink& aSink)
+		: mySink(&aSink)
+	{
+	}
+
+	std::vector<Token> TokenStream::Get()&&
 	{
-		return myTokens;
+		if (myChunks.size() == 1 && mySpliced.empty())
+			return std::move(*myChunks.front());
+
+		std::vector<Token> out;
+		out.reserve(mySize);
+
+		std::vector<std::unique_ptr<std::vector<Token>>>::iterator chunk = myChunks.begin();
+		for (const Segment& segment : mySegments)
+		{
+			if (chunk != myChunks.end() && segment.myData == (*chunk)->data())
+			{
+				out.insert(std::end(out), std::make_move_iterator((*chunk)->begin()), std::make_move_iterator((*chunk)->end()));
+				chunk++;
+				continue;
+			}
+
+			out.insert(std::end(out), segment.myData, segment.myData + segment.mySize);
+		}
+
+		return out;
 	}
 
 	TokenStream& TokenStream::operator<<(const Token& aToken)
 	{
-		myTokens.push_back(aToken);
+		if (mySink)
+		{
+			mySink->Consume(aToken);
+			return *this;
+		}
+
+		if (!myTail || myTail->size() == ourChunkSize)
+		{
+			myTail = myChunks.emplace_back(std::make_unique<std::vector<Token>>()).get();
+			myTail->reserve(ourChunkSize);
+			mySegments.push_back({ myTail->data(), 0, mySize });
+		}
+
+		myTail->push_back(aToken);
+		mySegments.back().mySize++;
+		mySize++;
 		return *this;
 	}
 
 	TokenStream& TokenStream::operator<<(const std::vector<Token>& aTokens)
 	{
-		//myTokens.reserve(myTokens.size() + aTokens.size());
-		myTokens.insert(std::end(myTokens), std::begin(aTokens), std::end(aTokens));
+		for (const Token& token : aTokens)
+			*this << token;
 		return *this;
 	}
+
+	void TokenStream::Splice(std::shared_ptr<const std::vector<Token>> aSegment)
+	{
+		if (mySink)
+		{
+			for (const Token& token : *aSegment)
+				mySink->Consume(token);
+			return;
+		}
+
+		if (aSegment->empty())
+			return;
+
+		mySegments.push_back({ aSegment->data(), aSegment->size(), mySize });
+		mySize += aSegment->size();
+		mySpliced.push_back(std::move(aSegment));
+		myTail = nullptr;
+	}
+
+	size_t TokenStream::FindSegment(size_t aIndex) const
+	{
+		if (aIndex >= mySize)
+			return mySegments.size();
+
+		std::vector<Segment>::const_iterator it = std::upper_bound(mySegments.begin(), mySegments.end(), aIndex, [](size_t aIndex, const Segment& aSegment) { return aIndex < aSegment.myStart; });
+		return std::distance(mySegments.begin(), it) - 1;
+	}
 } // tokenizer
@@ -1,23 +1,111 @@
 #ifndef TOKENIZER_TOKENSTREAM_H
 #define TOKENIZER_TOKENSTREAM_H
 
+#include <iterator>
+#include <memory>
 #include <vector>
 
 #include "tokenizer/token.h"
 
 namespace tokenizer
 {
+	// Receives tokens as they are produced instead of having them collected
+	class TokenSink
+	{
+	public:
+		virtual ~TokenSink() = default;
+
+		virtual void Consume(const Token& aToken) = 0;
+	};
+
+	// Rope of token segments, tokens are appended into fixed size chunks that are never reallocated and
+	// token vectors shared between translation units are spliced in by reference instead of being copied
 	class TokenStream
 	{
 	public:
-		std::vector<Token>& Get() &&;
+		class const_iterator
+		{
+		public:
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type = Token;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const Token*;
+			using reference = const Token&;
+
+			const_iterator() = default;
+
+			reference operator*() const { return *myToken; }
+			pointer operator->() const { return myToken; }
+			reference operator[](difference_type aOffset) const { return *(*this + aOffset); }
+
+			const_iterator& operator++();
+			const_iterator operator++(int) { const_iterator copy = *this; ++*this; return copy; }
+			const_iterator& operator--() { return *this -= 1; }
+			const_iterator operator--(int) { const_iterator copy = *this; --*this; return copy; }
+
+			const_iterator& operator+=(difference_type aOffset);
+			const_iterator& operator-=(difference_type aOffset) { return *this += -aOffset; }
+
+			friend const_iterator operator+(const_iterator aIt, difference_type aOffset) { return aIt += aOffset; }
+			friend const_iterator operator+(difference_type aOffset, const_iterator aIt) { return aIt += aOffset; }
+			friend const_iterator operator-(const_iterator aIt, difference_type aOffset) { return aIt -= aOffset; }
+			friend difference_type operator-(const const_iterator& aLeft, const const_iterator& aRight) { return static_cast<difference_type>(aLeft.myIndex) - static_cast<difference_type>(aRight.myIndex); }
+
+			friend bool operator==(const const_iterator& aLeft, const const_iterator& aRight) { return aLeft.myIndex == aRight.myIndex; }
+			friend auto operator<=>(const const_iterator& aLeft, const const_iterator& aRight) { return aLeft.myIndex <=> aRight.myIndex; }
+
+		private:
+			friend TokenStream;
+
+			const_iterator(const TokenStream* aStream, size_t aIndex);
+
+			const TokenStream* myStream = nullptr;
+			size_t mySegment = 0;
+			size_t myIndex = 0;
+			const Token* myToken = nullptr;
+		};
+
+		TokenStream() = default;
+
+		// Every token is handed straight to the sink, the stream itself stays empty
+		explicit TokenStream(TokenSink& aSink);
+
+		std::vector<Token> Get() &&;
 
 		TokenStream&	operator<<(const Token& aToken);
 		TokenStream&	operator<<(const std::vector<Token>& aTokens);
 
+		// Appends the tokens without copying them, they are shared with whoever else holds the segment
+		void Splice(std::shared_ptr<const std::vector<Token>> aSegment);
+
+		const_iterator begin() const { return const_iterator(this, 0); }
+		const_iterator end() const { return const_iterator(this, mySize); }
+		size_t size() const { return mySize; }
+		bool empty() const { return mySize == 0; }
+		const Token& operator[](size_t aIndex) const { return begin()[aIndex]; }
+
 	private:
-		std::vector<Token> myTokens;
+		struct Segment
+		{
+			const Token* myData;
+			size_t mySize;
+			size_t myStart; // index of the first token in the whole stream
+		};
+
+		size_t FindSegment(size_t aIndex) const;
+
+		static constexpr size_t ourChunkSize = 4096;
+
+		std::vector<Segment> mySegments;
+		std::vector<std::unique_ptr<std::vector<Token>>> myChunks; // reserved to ourChunkSize up front so tokens never move
+		std::vector<std::shared_ptr<const std::vector<Token>>> mySpliced;
+		std::vector<Token>* myTail = nullptr; // chunk that is still being appended to, if it is the last segment
+		size_t mySize = 0;
+
+		TokenSink* mySink = nullptr;
 	};
+
+	static_assert(std::random_access_iterator<TokenStream::const_iterator>);
 }
 
-#endif // TOKENIZER_TOKENSTREAM_H
\ No newline at end of file
+#endif // TOKENIZER_TOKENSTREAM_H
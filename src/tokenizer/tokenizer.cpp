@@ -1,13 +1,19 @@
 #include "tokenizer.h"
 
+#include <optional>
 #include <stack>
+#include <thread>
+#include <utility>
 
 #include "tools/fileHelpers.h"
+#include "tools/SpscRing.h"
 
 #include "tokenizer/tokenMatcher.h"
 #include "tokenizer/tokenStream.h"
 
 #include "common/CompilerContext.h"
+#include "common/IncludeReport.h"
+#include "common/TimeTrace.h"
 
 #include "precompiler/precompiler.h"
 
@@ -77,62 +83,247 @@ namespace tokenizer
 		std::vector<std::string> out;
 		for (size_t i = 0; i < aLines.size(); i++)
 		{
-			const std::string& line = aLines[i];
-			if (line.length() > 0 && line.back() == '\\')
+			std::string line = aLines[i];
+			while (line.length() > 0 && line.back() == '\\')
 			{
+				line.pop_back();
 				if (i + 1 == aLines.size())
 				{
-					CompilerContext::EmitError("[\\] concatination at end of file", CompilerContext::GetCurrentFile(), i, line.length() - 1);
+					CompilerContext::EmitError("[\\] concatination at end of file", CompilerContext::GetCurrentFile(), line.length(), i);
+					break;
 				}
 
-				std::string concatenated = line.substr(0, line.length() - 1) + aLines[i + 1];
-				out.push_back(concatenated);
-				i++;
-			}
-			else
-			{
-				out.push_back(line);
+				line += aLines[++i];
 			}
+			out.push_back(std::move(line));
 		}
 		return out;
 	}
 
-	std::vector<Token> PreCompile(const std::vector<std::string>& aLines)
+	// each stage is what diagnostics quote until the next one is done, the earlier ones are freed as it takes over
+	CompilerContext::Source LogicalSource(const std::filesystem::path& aFilePath, size_t& aOutBytes)
 	{
-		TokenStream stream;
-		Precompiler::FileContext fileContext;
+		std::string file = TimeTrace::IsEnabled() ? aFilePath.generic_string() : std::string();
 
+		std::optional<TimeTrace::Span> span;
+		span.emplace("ReadWholeFile", file);
+		CompilerContext::Source physicalSource = std::make_shared<const std::vector<std::string>>(ReadWholeFile(aFilePath));
+		aOutBytes = 0;
+		for (const std::string& line : *physicalSource)
+			aOutBytes += line.size() + 1;
+		CompilerContext::SetPrintContext(physicalSource);
+	
+		span.emplace("UniversalEscape", file);
+		CompilerContext::Source escapedPhysicalSource = std::make_shared<const std::vector<std::string>>(UniversalEscape(*physicalSource));
+		physicalSource.reset();
+		CompilerContext::SetPrintContext(escapedPhysicalSource);
+
+		span.emplace("Reduce", file);
+		CompilerContext::Source logicalSource = std::make_shared<const std::vector<std::string>>(Reduce(*escapedPhysicalSource));
+		escapedPhysicalSource.reset();
+		CompilerContext::SetPrintContext(logicalSource);
+
+		return logicalSource;
+	}
+
+	// calls aConsumer with the tokens of every logical line, a token spanning lines makes one line out of them
+	template<class Consumer>
+	void SplitLines(const std::vector<std::string>& aLines, Consumer&& aConsumer)
+	{
 		TokenMatcher::Context	tokenContext;
 		size_t i = 0;
 		while (true)
 		{
 			CompilerContext::SetCurrentLine(i);
+			size_t start = i;
 			std::vector<Token> lineTokens;
 			do 
 			{
 				if(i == aLines.size())
-					return std::move(stream).Get();
+					return;
 	
 				TokenMatcher::MatchTokens(lineTokens, aLines[i++], tokenContext);
 			} while (tokenContext.NeedsMoreInput());
 
-			Precompiler::ConsumeLine(fileContext, stream, lineTokens);
+			aConsumer(start, std::move(lineTokens));
+		}
+	}
+
+	namespace pipeline
+	{
+		// smaller files are split into tokens faster than a thread can be started for them
+		const std::uintmax_t MinBytes = 64 * 1024;
+		const size_t BatchLines = 128;
+		const size_t RingBatches = 8;
+
+		bool ourIsEnabled = false;
+
+		struct Line
+		{
+			size_t myLine;
+			std::vector<Token> myTokens;
+			std::vector<Diagnostic> myDiagnostics; // what splitting the line emitted, delivered right before it is preprocessed
+			size_t myErrors = 0;
+		};
+	}
+
+	// Splits the lines into tokens on a thread of its own while the calling thread preprocesses the lines already split
+	// The split lines are handed over in batches, an empty batch marks the end of the file
+	void ConsumePipelined(const std::filesystem::path& aFilePath, const CompilerContext::Source& aLogicalSource, Precompiler::FileContext& aFileContext, TokenStream& aOutTokens)
+	{
+		using namespace pipeline;
+
+		SpscRing<std::vector<Line>> ring(RingBatches);
+		bool ignoringErrors = CompilerContext::IsIgnoringErrors();
+
+		std::thread lexer([&]()
+			{
+				CompilerContext::State state;
+				state.myFileStack.push(aFilePath);
+				state.myPrintContext = aLogicalSource;
+				state.myIgnoreDepth = ignoringErrors ? 1 : 0;
+				CompilerContext::Scope scope(state);
+
+				std::vector<Diagnostic> diagnostics;
+				CompilerContext::Collect collect(diagnostics);
+
+				TimeTrace::Span span("SplitLines", TimeTrace::IsEnabled() ? aFilePath.generic_string() : std::string());
+
+				std::vector<Line> batch;
+				SplitLines(*aLogicalSource, [&](size_t aLine, std::vector<Token>&& aLineTokens)
+					{
+						Line& line = batch.emplace_back(aLine, std::move(aLineTokens));
+						line.myDiagnostics = std::exchange(diagnostics, {});
+						line.myErrors = std::exchange(state.myErrorCount, 0);
+
+						if (batch.size() == BatchLines)
+							ring.Push(std::exchange(batch, {}));
+					});
+
+				if (!batch.empty())
+					ring.Push(std::move(batch));
+				ring.Push({});
+			});
+
+		for (std::vector<Line> batch = ring.Pop(); !batch.empty(); batch = ring.Pop())
+		{
+			for (const Line& line : batch)
+			{
+				for (const Diagnostic& diagnostic : line.myDiagnostics)
+					CompilerContext::Deliver(diagnostic);
+				for (size_t i = 0; i < line.myErrors; i++)
+					CompilerContext::AddReplayedError();
+
+				CompilerContext::SetCurrentLine(line.myLine);
+				Precompiler::ConsumeLine(aFileContext, aOutTokens, line.myTokens);
+			}
 		}
+
+		lexer.join();
+		CompilerContext::SetCurrentLine(aLogicalSource->size());
+	}
+
+	void EnablePipeline()
+	{
+		pipeline::ourIsEnabled = true;
+	}
+
+	thread_local LineCache* LineCache::ourCurrent = nullptr;
+
+	LineCache::LineCache()
+		: myPrevious(ourCurrent)
+	{
+		ourCurrent = this;
+	}
+
+	LineCache::~LineCache()
+	{
+		ourCurrent = myPrevious;
 	}
 
 	std::vector<Token> Tokenize(const std::filesystem::path& aFilePath)
 	{
-		std::vector<std::string> physicalSource = ReadWholeFile(aFilePath);
-		CompilerContext::SetPrintContext(physicalSource);
-	
-		std::vector<std::string> escapedPhysicalSource = UniversalEscape(physicalSource);
-		CompilerContext::SetPrintContext(escapedPhysicalSource);
+		TokenStream stream;
+		Tokenize(aFilePath, stream);
+		return std::move(stream).Get();
+	}
 
-		std::vector<std::string> logicalSource = Reduce(escapedPhysicalSource);
-		CompilerContext::SetPrintContext(logicalSource);
+	void Tokenize(const std::filesystem::path& aFilePath, TokenStream& aOutTokens)
+	{
+		Precompiler::FileContext fileContext;
+
+		if (!LineCache::ourCurrent)
+		{
+			size_t bytes;
+			CompilerContext::Source logicalSource = LogicalSource(aFilePath, bytes);
+			IncludeReport::CountBytes(bytes);
 
-		std::vector<Token> tokens = PreCompile(logicalSource);
+			if (pipeline::ourIsEnabled && bytes >= pipeline::MinBytes)
+			{
+				ConsumePipelined(aFilePath, logicalSource, fileContext, aOutTokens);
+				return;
+			}
 
-		return tokens;
+			SplitLines(*logicalSource, [&](size_t, std::vector<Token>&& aLineTokens)
+				{
+					Precompiler::ConsumeLine(fileContext, aOutTokens, aLineTokens);
+				});
+			return;
+		}
+
+		// relative paths are spelled the way they were found, which only means the same file from the same working directory
+		std::string key = aFilePath.generic_string();
+		if (aFilePath.is_relative())
+			key = std::filesystem::current_path().generic_string() + '\n' + key;
+
+		std::error_code error;
+		std::filesystem::file_time_type modified = std::filesystem::last_write_time(aFilePath, error);
+		std::uintmax_t size = error ? 0 : std::filesystem::file_size(aFilePath, error);
+
+		bool ignoringErrors = CompilerContext::IsIgnoringErrors();
+
+		std::shared_ptr<const LineCache::File>& cached = LineCache::ourCurrent->myFiles[std::move(key)];
+		bool isCached = cached && !error && cached->myModified == modified && cached->mySize == size && (ignoringErrors || !cached->myIgnoredErrors);
+		if (!isCached)
+		{
+			std::shared_ptr<LineCache::File> file = std::make_shared<LineCache::File>();
+			file->myModified = modified;
+			file->mySize = size;
+			file->myIgnoredErrors = ignoringErrors;
+
+			size_t errors = CompilerContext::GetErrorCount();
+			{
+				CompilerContext::Collect collect(file->myDiagnostics);
+				file->myLogicalSource = LogicalSource(aFilePath, file->myBytes);
+				SplitLines(*file->myLogicalSource, [&file](size_t aLine, std::vector<Token>&& aLineTokens)
+					{
+						file->myLines.emplace_back(aLine, std::move(aLineTokens));
+					});
+			}
+			file->myErrors = CompilerContext::GetErrorCount() - errors;
+			cached = std::move(file);
+		}
+
+		// held on to as a file that includes itself can find it changed and replace the entry
+		std::shared_ptr<const LineCache::File> file = cached;
+
+		// the errors of a file that was just read are already counted, a cached one fails the compilation all the same
+		if (!ignoringErrors)
+		{
+			for (const Diagnostic& diagnostic : file->myDiagnostics)
+				CompilerContext::Deliver(diagnostic);
+			for (size_t i = 0; isCached && i < file->myErrors; i++)
+				CompilerContext::AddReplayedError();
+		}
+
+		IncludeReport::CountBytes(file->myBytes);
+		CompilerContext::SetPrintContext(file->myLogicalSource);
+
+		for (const std::pair<size_t, std::vector<Token>>& line : file->myLines)
+		{
+			CompilerContext::SetCurrentLine(line.first);
+			Precompiler::ConsumeLine(fileContext, aOutTokens, line.second);
+		}
+		CompilerContext::SetCurrentLine(file->myLogicalSource->size());
 	}
 }
\ No newline at end of file
@@ -4,12 +4,60 @@
 #include <vector>
 #include <string>
 #include <filesystem>
+#include <memory>
+#include <unordered_map>
+
+#include "common/Diagnostics.h"
 
 #include "tokenizer/token.h"
+#include "tokenizer/tokenStream.h"
 
 namespace tokenizer
 {
+	// 5.2 Phases of translation Step 2, joins lines ending in a backslash with the lines after them
+	std::vector<std::string> Reduce(const std::vector<std::string>& aLines);
+
 	std::vector<Token> Tokenize(const std::filesystem::path& aFilePath);
+
+	// Preprocesses the file straight into the stream, included files go into the same stream
+	void Tokenize(const std::filesystem::path& aFilePath, TokenStream& aOutTokens);
+
+	// From then on files of 64 KiB or more are split into tokens on a second thread while the calling thread preprocesses them
+	void EnablePipeline();
+
+	// While alive every file tokenized on this thread is kept as lines of tokens, preprocessing the same files again
+	// only reruns the directives and macro expansions, a file is read again once its size or modification time changes
+	class LineCache
+	{
+	public:
+		LineCache();
+		~LineCache();
+
+		static bool IsActive() { return ourCurrent != nullptr; }
+
+		LineCache(const LineCache&) = delete;
+		LineCache& operator=(const LineCache&) = delete;
+
+	private:
+		friend void Tokenize(const std::filesystem::path& aFilePath, TokenStream& aOutTokens);
+
+		struct File
+		{
+			std::shared_ptr<const std::vector<std::string>> myLogicalSource;
+			std::vector<std::pair<size_t, std::vector<Token>>> myLines; // the logical line each starts on and its tokens
+			std::vector<Diagnostic> myDiagnostics; // what reading and splitting the file emitted, delivered again every time it is used
+			size_t myErrors = 0;
+			bool myIgnoredErrors = false; // read while errors were ignored, nothing was kept to deliver
+			size_t myBytes = 0;
+			std::uintmax_t mySize = 0;
+			std::filesystem::file_time_type myModified;
+		};
+
+		std::unordered_map<std::string, std::shared_ptr<const File>> myFiles;
+		LineCache* myPrevious;
+
+		static thread_local LineCache* ourCurrent;
+	};
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include "tools/BufferedWriter.h"
+
+#include <cstring>
+
+BufferedWriter::BufferedWriter(const std::filesystem::path& aFilePath, size_t aBufferSize)
+	: myFile(aFilePath, std::ios::binary)
+	, myBuffer(std::make_unique<char[]>(aBufferSize))
+	, mySize(aBufferSize)
+{
+}
+
+BufferedWriter::~BufferedWriter()
+{
+	Flush();
+}
+
+void BufferedWriter::Write(std::string_view aText)
+{
+	if (aText.size() > mySize - myUsed)
+	{
+		Flush();
+
+		if (aText.size() > mySize)
+		{
+			myFile.write(aText.data(), aText.size());
+			return;
+		}
+	}
+
+	std::memcpy(myBuffer.get() + myUsed, aText.data(), aText.size());
+	myUsed += aText.size();
+}
+
+void BufferedWriter::Write(char aCharacter)
+{
+	if (myUsed == mySize)
+		Flush();
+
+	myBuffer[myUsed++] = aCharacter;
+}
+
+void BufferedWriter::Flush()
+{
+	if (myUsed == 0)
+		return;
+
+	myFile.write(myBuffer.get(), myUsed);
+	myFile.flush();
+	myUsed = 0;
+}
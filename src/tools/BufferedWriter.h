@@ -0,0 +1,36 @@
+#ifndef TOOLS_BUFFEREDWRITER_H
+#define TOOLS_BUFFEREDWRITER_H
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string_view>
+
+// Write only file that collects output in one large buffer, the file is only touched when the buffer fills up
+class BufferedWriter
+{
+public:
+	BufferedWriter(const std::filesystem::path& aFilePath, size_t aBufferSize = ourDefaultBufferSize);
+	~BufferedWriter();
+
+	BufferedWriter(const BufferedWriter&) = delete;
+	BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+	void Write(std::string_view aText);
+	void Write(char aCharacter);
+
+	void Flush();
+
+	// False once opening or any write to the file has failed
+	bool Good() const { return static_cast<bool>(myFile); }
+
+	static constexpr size_t ourDefaultBufferSize = 1 << 20;
+
+private:
+	std::ofstream myFile;
+	std::unique_ptr<char[]> myBuffer;
+	size_t mySize;
+	size_t myUsed = 0;
+};
+
+#endif
@@ -0,0 +1,163 @@
+#include "DiskCache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace disk_cache_internal
+{
+	const std::string_view Magic = "fiskcache 1\n";
+	const std::string_view EntryExtension = ".entry";
+	const std::string_view TemporaryExtension = ".tmp";
+
+	// temporary files left behind by a process that died while writing are removed after this long
+	const std::chrono::hours AbandonedAfter(1);
+
+	// evicting down to a bit below the limit so every write after does not have to scan again
+	const double EvictTo = 0.9;
+}
+
+DiskCache::DiskCache(const std::filesystem::path& aDirectory, uint64_t aMaxBytes)
+	: myDirectory(aDirectory)
+	, myMaxBytes(aMaxBytes)
+{
+	std::error_code error;
+	std::filesystem::create_directories(myDirectory, error);
+}
+
+std::optional<std::string> DiskCache::Get(uint64_t aKey)
+{
+	using namespace disk_cache_internal;
+
+	std::filesystem::path path = PathOf(aKey);
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return {};
+
+	std::ostringstream content;
+	content << file.rdbuf();
+	std::string data = std::move(content).str();
+
+	if (!data.starts_with(Magic))
+		return {};
+
+	// the modification time is what eviction orders by, a failure here only makes the entry look older than it is
+	std::error_code error;
+	std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+	return data.substr(Magic.size());
+}
+
+bool DiskCache::Put(uint64_t aKey, std::string_view aData)
+{
+	using namespace disk_cache_internal;
+
+	static thread_local std::mt19937_64 generator(std::random_device{}());
+
+	std::filesystem::path path = PathOf(aKey);
+	std::filesystem::path temporary = path;
+	temporary += "." + std::to_string(generator()) + std::string(TemporaryExtension);
+
+	{
+		std::ofstream file(temporary, std::ios::binary);
+		file << Magic << aData;
+		file.close();
+		if (!file)
+		{
+			std::error_code error;
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+	}
+
+	// another process may have written the same entry meanwhile, that one is just as good as this one
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error)
+	{
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+
+	// stamped with the same clock as reads so that eviction compares like with like
+	std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+	if (myKnownBytes)
+		*myKnownBytes += Magic.size() + aData.size();
+
+	if (!myKnownBytes || *myKnownBytes > myMaxBytes)
+		Evict();
+
+	return true;
+}
+
+std::filesystem::path DiskCache::PathOf(uint64_t aKey) const
+{
+	using namespace disk_cache_internal;
+
+	std::ostringstream name;
+	name << std::hex;
+	name.width(16);
+	name.fill('0');
+	name << aKey << EntryExtension;
+	return myDirectory / name.str();
+}
+
+void DiskCache::Evict()
+{
+	using namespace disk_cache_internal;
+
+	struct Entry
+	{
+		std::filesystem::path myPath;
+		std::filesystem::file_time_type myUsed;
+		uint64_t mySize;
+	};
+
+	std::vector<Entry> entries;
+	uint64_t total = 0;
+	std::filesystem::file_time_type now = std::filesystem::file_time_type::clock::now();
+
+	std::error_code error;
+	for (std::filesystem::directory_iterator it(myDirectory, error), end; !error && it != end; it.increment(error))
+	{
+		std::error_code entryError;
+		std::filesystem::file_time_type used = it->last_write_time(entryError);
+		uint64_t size = it->file_size(entryError);
+		if (entryError)
+			continue;
+
+		std::filesystem::path extension = it->path().extension();
+		if (extension == TemporaryExtension)
+		{
+			if (now - used > AbandonedAfter)
+				std::filesystem::remove(it->path(), entryError);
+			continue;
+		}
+		if (extension != EntryExtension)
+			continue;
+
+		entries.push_back({ it->path(), used, size });
+		total += size;
+	}
+
+	if (total > myMaxBytes)
+	{
+		std::ranges::sort(entries, [](const Entry& aLeft, const Entry& aRight) { return aLeft.myUsed < aRight.myUsed; });
+
+		uint64_t target = static_cast<uint64_t>(myMaxBytes * EvictTo);
+		for (const Entry& entry : entries)
+		{
+			if (total <= target)
+				break;
+
+			// someone else may be evicting the same entry, it is gone either way
+			std::filesystem::remove(entry.myPath, error);
+			total -= entry.mySize;
+		}
+	}
+
+	myKnownBytes = total;
+}
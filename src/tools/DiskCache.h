@@ -0,0 +1,32 @@
+#ifndef TOOLS_DISKCACHE_H
+#define TOOLS_DISKCACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Blobs on disk found by a hash of everything they were made from, one file per entry so any number of processes can share it
+// Entries are written under a temporary name and renamed into place so nobody sees half an entry, reading an entry
+// marks it as used and the least recently used ones are removed once the directory grows past its size limit
+class DiskCache
+{
+public:
+	DiskCache(const std::filesystem::path& aDirectory, uint64_t aMaxBytes);
+
+	std::optional<std::string> Get(uint64_t aKey);
+	bool Put(uint64_t aKey, std::string_view aData);
+
+private:
+	std::filesystem::path PathOf(uint64_t aKey) const;
+	void Evict();
+
+	std::filesystem::path myDirectory;
+	uint64_t myMaxBytes;
+
+	// what this process believes is in the directory, only scanned for real once it looks to be over the limit
+	std::optional<uint64_t> myKnownBytes;
+};
+
+#endif
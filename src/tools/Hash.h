@@ -0,0 +1,121 @@
+#ifndef TOOLS_HASH_H
+#define TOOLS_HASH_H
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Streaming XXH64, fast enough to run over a whole token stream and stable between runs and platforms of the same endianness
+class Hash
+{
+public:
+	Hash(uint64_t aSeed = 0)
+		: myLanes{ aSeed + ourPrime1 + ourPrime2, aSeed + ourPrime2, aSeed, aSeed - ourPrime1 }
+		, mySeed(aSeed)
+	{
+	}
+
+	void Add(std::string_view aData)
+	{
+		myLength += aData.size();
+
+		if (myBuffered + aData.size() < sizeof(myBuffer))
+		{
+			std::memcpy(myBuffer + myBuffered, aData.data(), aData.size());
+			myBuffered += aData.size();
+			return;
+		}
+
+		if (myBuffered > 0)
+		{
+			size_t fill = sizeof(myBuffer) - myBuffered;
+			std::memcpy(myBuffer + myBuffered, aData.data(), fill);
+			Stripe(myBuffer);
+			aData.remove_prefix(fill);
+			myBuffered = 0;
+		}
+
+		while (aData.size() >= sizeof(myBuffer))
+		{
+			Stripe(aData.data());
+			aData.remove_prefix(sizeof(myBuffer));
+		}
+
+		std::memcpy(myBuffer, aData.data(), aData.size());
+		myBuffered = aData.size();
+	}
+
+	template<class Value>
+	void AddValue(const Value& aValue)
+	{
+		Add(std::string_view(reinterpret_cast<const char*>(&aValue), sizeof(aValue)));
+	}
+
+	uint64_t Get() const
+	{
+		uint64_t hash;
+		if (myLength >= sizeof(myBuffer))
+		{
+			hash = Rotate(myLanes[0], 1) + Rotate(myLanes[1], 7) + Rotate(myLanes[2], 12) + Rotate(myLanes[3], 18);
+			for (uint64_t lane : myLanes)
+				hash = (hash ^ Round(0, lane)) * ourPrime1 + ourPrime4;
+		}
+		else
+		{
+			hash = mySeed + ourPrime5;
+		}
+
+		hash += myLength;
+
+		const char* at = myBuffer;
+		const char* end = myBuffer + myBuffered;
+		for (; at + 8 <= end; at += 8)
+			hash = Rotate(hash ^ Round(0, Read<uint64_t>(at)), 27) * ourPrime1 + ourPrime4;
+		if (at + 4 <= end)
+		{
+			hash = Rotate(hash ^ (Read<uint32_t>(at) * ourPrime1), 23) * ourPrime2 + ourPrime3;
+			at += 4;
+		}
+		for (; at < end; at++)
+			hash = Rotate(hash ^ (static_cast<uint8_t>(*at) * ourPrime5), 11) * ourPrime1;
+
+		hash ^= hash >> 33;
+		hash *= ourPrime2;
+		hash ^= hash >> 29;
+		hash *= ourPrime3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+private:
+	static constexpr uint64_t ourPrime1 = 0x9E3779B185EBCA87ull;
+	static constexpr uint64_t ourPrime2 = 0xC2B2AE3D27D4EB4Full;
+	static constexpr uint64_t ourPrime3 = 0x165667B19E3779F9ull;
+	static constexpr uint64_t ourPrime4 = 0x85EBCA77C2B2AE63ull;
+	static constexpr uint64_t ourPrime5 = 0x27D4EB2F165667C5ull;
+
+	static uint64_t Rotate(uint64_t aValue, int aBits) { return (aValue << aBits) | (aValue >> (64 - aBits)); }
+	static uint64_t Round(uint64_t aLane, uint64_t aInput) { return Rotate(aLane + aInput * ourPrime2, 31) * ourPrime1; }
+
+	template<class Value>
+	static Value Read(const char* aAt)
+	{
+		Value value;
+		std::memcpy(&value, aAt, sizeof(value));
+		return value;
+	}
+
+	void Stripe(const char* aStripe)
+	{
+		for (size_t i = 0; i < 4; i++)
+			myLanes[i] = Round(myLanes[i], Read<uint64_t>(aStripe + i * 8));
+	}
+
+	uint64_t myLanes[4];
+	uint64_t mySeed;
+	uint64_t myLength = 0;
+	char myBuffer[32];
+	size_t myBuffered = 0;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "LocalSocket.h"
+
+#include <utility>
+
+#if __linux__
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+LocalSocket::LocalSocket(LocalSocket&& aOther) noexcept
+	: myHandle(std::exchange(aOther.myHandle, -1))
+{
+}
+
+LocalSocket& LocalSocket::operator=(LocalSocket&& aOther) noexcept
+{
+	std::swap(myHandle, aOther.myHandle);
+	return *this;
+}
+
+#if __linux__
+namespace local_socket_internal
+{
+	bool MakeAddress(const std::filesystem::path& aPath, sockaddr_un& aOutAddress)
+	{
+		const std::string& path = aPath.native();
+		aOutAddress = {};
+		if (path.size() >= sizeof(aOutAddress.sun_path))
+			return false;
+
+		aOutAddress.sun_family = AF_UNIX;
+		std::memcpy(aOutAddress.sun_path, path.c_str(), path.size() + 1);
+		return true;
+	}
+}
+
+LocalSocket LocalSocket::Listen(const std::filesystem::path& aPath)
+{
+	sockaddr_un address;
+	if (!local_socket_internal::MakeAddress(aPath, address))
+		return {};
+
+	LocalSocket socket(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+	if (!socket.IsValid())
+		return {};
+
+	unlink(address.sun_path);
+	if (bind(socket.myHandle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(socket.myHandle, SOMAXCONN) != 0)
+		return {};
+
+	return socket;
+}
+
+LocalSocket LocalSocket::Connect(const std::filesystem::path& aPath)
+{
+	sockaddr_un address;
+	if (!local_socket_internal::MakeAddress(aPath, address))
+		return {};
+
+	LocalSocket socket(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+	if (!socket.IsValid() || connect(socket.myHandle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+		return {};
+
+	return socket;
+}
+
+LocalSocket::~LocalSocket()
+{
+	if (myHandle >= 0)
+		close(myHandle);
+}
+
+LocalSocket LocalSocket::Accept() const
+{
+	while (true)
+	{
+		int connection = accept4(myHandle, nullptr, nullptr, SOCK_CLOEXEC);
+		if (connection >= 0)
+			return LocalSocket(connection);
+
+		if (errno != EINTR && errno != ECONNABORTED)
+			return {};
+	}
+}
+
+bool LocalSocket::Write(std::string_view aData) const
+{
+	while (!aData.empty())
+	{
+		ssize_t written = write(myHandle, aData.data(), aData.size());
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return false;
+		aData.remove_prefix(written);
+	}
+	return true;
+}
+
+std::string LocalSocket::ReadAll() const
+{
+	std::string out;
+	char buffer[4096];
+	while (true)
+	{
+		ssize_t got = read(myHandle, buffer, sizeof(buffer));
+		if (got < 0 && errno == EINTR)
+			continue;
+		if (got <= 0)
+			return out;
+		out.append(buffer, got);
+	}
+}
+
+void LocalSocket::EndWrite() const
+{
+	shutdown(myHandle, SHUT_WR);
+}
+#else
+LocalSocket LocalSocket::Listen(const std::filesystem::path&)
+{
+	return {};
+}
+
+LocalSocket LocalSocket::Connect(const std::filesystem::path&)
+{
+	return {};
+}
+
+LocalSocket::~LocalSocket()
+{
+}
+
+LocalSocket LocalSocket::Accept() const
+{
+	return {};
+}
+
+bool LocalSocket::Write(std::string_view) const
+{
+	return false;
+}
+
+std::string LocalSocket::ReadAll() const
+{
+	return {};
+}
+
+void LocalSocket::EndWrite() const
+{
+}
+#endif
@@ -0,0 +1,42 @@
+#ifndef TOOLS_LOCALSOCKET_H
+#define TOOLS_LOCALSOCKET_H
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// Stream socket bound to a path in the file system, a unix domain socket so it is only ever valid on linux
+class LocalSocket
+{
+public:
+	// Replaces whatever socket a previous listener left behind at the path
+	static LocalSocket Listen(const std::filesystem::path& aPath);
+	static LocalSocket Connect(const std::filesystem::path& aPath);
+
+	LocalSocket() = default;
+	~LocalSocket();
+
+	LocalSocket(LocalSocket&& aOther) noexcept;
+	LocalSocket& operator=(LocalSocket&& aOther) noexcept;
+
+	bool IsValid() const { return myHandle >= 0; }
+	explicit operator bool() const { return IsValid(); }
+	int GetHandle() const { return myHandle; }
+
+	LocalSocket Accept() const;
+
+	bool Write(std::string_view aData) const;
+
+	// Reads until the other end stops writing
+	std::string ReadAll() const;
+
+	// Tells the other end nothing more will be written
+	void EndWrite() const;
+
+private:
+	explicit LocalSocket(int aHandle) : myHandle(aHandle) {}
+
+	int myHandle = -1;
+};
+
+#endif
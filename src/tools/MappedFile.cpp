@@ -0,0 +1,72 @@
+#include "MappedFile.h"
+
+#if _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if _WIN32
+MappedFile::MappedFile(const std::filesystem::path& aFilePath)
+{
+	myFile = CreateFileW(aFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (myFile == INVALID_HANDLE_VALUE)
+	{
+		myFile = nullptr;
+		return;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(myFile, &size) || size.QuadPart == 0)
+		return;
+
+	myMapping = CreateFileMappingW(myFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!myMapping)
+		return;
+
+	myData = static_cast<const char*>(MapViewOfFile(myMapping, FILE_MAP_READ, 0, 0, 0));
+	if (myData)
+		mySize = static_cast<size_t>(size.QuadPart);
+}
+
+MappedFile::~MappedFile()
+{
+	if (myData)
+		UnmapViewOfFile(myData);
+	if (myMapping)
+		CloseHandle(myMapping);
+	if (myFile)
+		CloseHandle(myFile);
+}
+#else
+MappedFile::MappedFile(const std::filesystem::path& aFilePath)
+{
+	int file = open(aFilePath.c_str(), O_RDONLY);
+	if (file < 0)
+		return;
+
+	struct stat info;
+	if (fstat(file, &info) == 0 && info.st_size > 0)
+	{
+		void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED)
+		{
+			myData = static_cast<const char*>(data);
+			mySize = static_cast<size_t>(info.st_size);
+		}
+	}
+
+	// the mapping keeps the file alive on its own
+	close(file);
+}
+
+MappedFile::~MappedFile()
+{
+	if (myData)
+		munmap(const_cast<char*>(myData), mySize);
+}
+#endif
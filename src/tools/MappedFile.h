@@ -0,0 +1,29 @@
+#ifndef TOOLS_MAPPEDFILE_H
+#define TOOLS_MAPPEDFILE_H
+
+#include <filesystem>
+#include <span>
+
+// Read only view of a whole file mapped into memory, empty if the file could not be mapped
+class MappedFile
+{
+public:
+	MappedFile(const std::filesystem::path& aFilePath);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	std::span<const char> Get() const { return { myData, mySize }; }
+
+private:
+	const char* myData = nullptr;
+	size_t mySize = 0;
+
+#if _WIN32
+	void* myFile = nullptr;
+	void* myMapping = nullptr;
+#endif
+};
+
+#endif
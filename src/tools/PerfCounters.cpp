@@ -0,0 +1,112 @@
+#include "PerfCounters.h"
+
+#if __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if __linux__
+namespace perf_counters_internal
+{
+	int Open(uint32_t aType, uint64_t aConfig, int aGroup)
+	{
+		perf_event_attr attributes{};
+		attributes.size = sizeof(attributes);
+		attributes.type = aType;
+		attributes.config = aConfig;
+		attributes.disabled = aGroup < 0; // the whole group starts once it is complete
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, aGroup, 0));
+	}
+}
+
+PerfCounters::PerfCounters()
+{
+	using namespace perf_counters_internal;
+
+	myFiles.fill(-1);
+	myGroupIndex.fill(-1);
+
+	const std::array<std::pair<uint32_t, uint64_t>, CounterCount> events =
+	{{
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) }
+	}};
+
+	myFiles[Cycles] = Open(events[Cycles].first, events[Cycles].second, -1);
+	if (myFiles[Cycles] < 0)
+	{
+		myProblem = errno == EACCES || errno == EPERM
+			? "the kernel does not allow it, see /proc/sys/kernel/perf_event_paranoid"
+			: std::string("perf_event_open failed, ") + std::strerror(errno);
+		return;
+	}
+
+	int groupSize = 0;
+	myGroupIndex[Cycles] = groupSize++;
+	for (int counter = Cycles + 1; counter < CounterCount; counter++)
+	{
+		myFiles[counter] = Open(events[counter].first, events[counter].second, myFiles[Cycles]);
+		if (myFiles[counter] >= 0)
+			myGroupIndex[counter] = groupSize++;
+	}
+
+	ioctl(myFiles[Cycles], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(myFiles[Cycles], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters::~PerfCounters()
+{
+	// the members go first so the group is never left without its leader
+	for (int counter = CounterCount - 1; counter >= 0; counter--)
+		if (myFiles[counter] >= 0)
+			close(myFiles[counter]);
+}
+
+PerfCounters::Values PerfCounters::Read() const
+{
+	Values values{};
+	if (!IsAvailable())
+		return values;
+
+	// the number of counters, the time enabled and running, then a value per counter in the order they were opened
+	uint64_t buffer[3 + CounterCount];
+	if (read(myFiles[Cycles], buffer, sizeof(buffer)) < static_cast<ssize_t>(3 * sizeof(uint64_t)))
+		return values;
+
+	uint64_t enabled = buffer[1];
+	uint64_t running = buffer[2];
+	for (int counter = 0; counter < CounterCount; counter++)
+	{
+		if (myGroupIndex[counter] < 0 || static_cast<uint64_t>(myGroupIndex[counter]) >= buffer[0])
+			continue;
+
+		uint64_t value = buffer[3 + myGroupIndex[counter]];
+		values[counter] = running == 0 || running == enabled ? value : static_cast<uint64_t>(static_cast<double>(value) * enabled / running);
+	}
+	return values;
+}
+#else
+PerfCounters::PerfCounters()
+{
+	myFiles.fill(-1);
+	myGroupIndex.fill(-1);
+	myProblem = "hardware counters are only read on linux";
+}
+
+PerfCounters::~PerfCounters() = default;
+
+PerfCounters::Values PerfCounters::Read() const
+{
+	return {};
+}
+#endif
@@ -0,0 +1,47 @@
+#ifndef TOOLS_PERF_COUNTERS_H
+#define TOOLS_PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Hardware counters of the calling thread through perf_event_open, so only ever available on linux
+// They are opened as one group so every counter covers exactly the same instructions, user space only
+class PerfCounters
+{
+public:
+	enum Counter
+	{
+		Cycles,
+		Instructions,
+		BranchMisses,
+		CacheMisses, // last level cache read misses
+		CounterCount
+	};
+
+	using Values = std::array<uint64_t, CounterCount>;
+
+	// Starts counting the calling thread, only that thread may read them
+	PerfCounters();
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	// Nothing is counted when the kernel does not allow it, GetProblem says why
+	bool IsAvailable() const { return myFiles[Cycles] >= 0; }
+	const std::string& GetProblem() const { return myProblem; }
+
+	// A machine can lack some counters and still have the others
+	bool Has(Counter aCounter) const { return myFiles[aCounter] >= 0; }
+
+	// Everything counted since construction, scaled up for time the kernel gave the counters to someone else
+	Values Read() const;
+
+private:
+	std::array<int, CounterCount> myFiles;
+	std::array<int, CounterCount> myGroupIndex; // where each counter is in a read of the group
+	std::string myProblem;
+};
+
+#endif
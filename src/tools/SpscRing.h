@@ -0,0 +1,75 @@
+#ifndef TOOLS_SPSCRING_H
+#define TOOLS_SPSCRING_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Fixed size queue between exactly one thread pushing and one thread popping, neither ever takes a lock
+// Each side only writes its own index and waits on the other's when the ring is full or empty,
+// so hand over batches rather than single items to keep the waiting rare
+template<class Value>
+class SpscRing
+{
+public:
+	explicit SpscRing(size_t aCapacity)
+		: mySlots(std::bit_ceil(std::max<size_t>(aCapacity, 2)))
+		, myMask(mySlots.size() - 1)
+	{
+	}
+
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	// Only ever called by the producer, waits while the ring is full
+	void Push(Value&& aValue)
+	{
+		size_t tail = myTail.load(std::memory_order_relaxed);
+		for (size_t head = myHead.load(std::memory_order_acquire); tail - head == mySlots.size(); head = myHead.load(std::memory_order_acquire))
+			myHead.wait(head, std::memory_order_acquire);
+
+		mySlots[tail & myMask] = std::move(aValue);
+		myTail.store(tail + 1, std::memory_order_release);
+		myTail.notify_one();
+	}
+
+	// Only ever called by the consumer, waits while the ring is empty
+	Value Pop()
+	{
+		size_t head = myHead.load(std::memory_order_relaxed);
+		for (size_t tail = myTail.load(std::memory_order_acquire); tail == head; tail = myTail.load(std::memory_order_acquire))
+			myTail.wait(tail, std::memory_order_acquire);
+
+		Value value = std::move(mySlots[head & myMask]);
+		myHead.store(head + 1, std::memory_order_release);
+		myHead.notify_one();
+		return value;
+	}
+
+	// Only ever called by the consumer, empty when there is nothing to pop instead of waiting
+	std::optional<Value> TryPop()
+	{
+		size_t head = myHead.load(std::memory_order_relaxed);
+		if (myTail.load(std::memory_order_acquire) == head)
+			return {};
+
+		std::optional<Value> value = std::move(mySlots[head & myMask]);
+		myHead.store(head + 1, std::memory_order_release);
+		myHead.notify_one();
+		return value;
+	}
+
+private:
+	std::vector<Value> mySlots;
+	size_t myMask;
+
+	// on lines of their own so the two threads do not keep taking the cache line from each other
+	alignas(64) std::atomic<size_t> myHead = 0; // next slot to pop, only written by the consumer
+	alignas(64) std::atomic<size_t> myTail = 0; // next slot to push, only written by the producer
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace work_stealing_pool_internal
+{
+	struct Queue
+	{
+		std::mutex myMutex;
+		std::deque<size_t> myTasks;
+
+		std::optional<size_t> PopFront()
+		{
+			std::lock_guard lock(myMutex);
+			if (myTasks.empty())
+				return {};
+
+			size_t task = myTasks.front();
+			myTasks.pop_front();
+			return task;
+		}
+
+		std::optional<size_t> PopBack()
+		{
+			std::lock_guard lock(myMutex);
+			if (myTasks.empty())
+				return {};
+
+			size_t task = myTasks.back();
+			myTasks.pop_back();
+			return task;
+		}
+	};
+}
+
+void WorkStealingPool::Run(size_t aTaskCount, size_t aThreadCount, const std::function<void(size_t aTask)>& aWork)
+{
+	using namespace work_stealing_pool_internal;
+
+	size_t threadCount = std::clamp<size_t>(aThreadCount, 1, std::max<size_t>(aTaskCount, 1));
+
+	std::vector<Queue> queues(threadCount);
+	for (size_t task = 0; task < aTaskCount; task++)
+		queues[task % threadCount].myTasks.push_back(task);
+
+	auto work = [&](size_t aIndex)
+	{
+		while (std::optional<size_t> task = queues[aIndex].PopFront())
+			aWork(*task);
+
+		// no task is ever added, so once every queue was found empty there is nothing left to steal
+		for (size_t offset = 1; offset < threadCount; offset++)
+		{
+			Queue& victim = queues[(aIndex + offset) % threadCount];
+			while (std::optional<size_t> task = victim.PopBack())
+				aWork(*task);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < threadCount; i++)
+		threads.emplace_back(work, i);
+
+	work(0);
+
+	for (std::thread& thread : threads)
+		thread.join();
+}
@@ -0,0 +1,15 @@
+#ifndef TOOLS_WORKSTEALINGPOOL_H
+#define TOOLS_WORKSTEALINGPOOL_H
+
+#include <functional>
+
+// Runs the tasks 0 to aTaskCount - 1 on aThreadCount threads, the calling thread being one of them, and returns once all are done
+// The tasks are dealt out in order like cards, each thread works through its own from the front and steals from the back
+// of another once it runs dry, so tasks given first are started first and no thread idles while there is work left
+class WorkStealingPool
+{
+public:
+	static void Run(size_t aTaskCount, size_t aThreadCount, const std::function<void(size_t aTask)>& aWork);
+};
+
+#endif
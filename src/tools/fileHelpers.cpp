@@ -1,5 +1,6 @@
 #include "fileHelpers.h"
 
+#include <algorithm>
 #include <fstream>
 
 #include "common/CompilerContext.h"
@@ -16,4 +17,16 @@ std::vector<std::string> ReadWholeFile(const std::filesystem::path& aFilePath)
 		out.push_back(line);
 
 	return out;
-}
\ No newline at end of file
+}
+
+std::string FileKey(const std::filesystem::path& aFile)
+{
+	std::error_code error;
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(aFile, error);
+	return (error ? aFile : canonical).generic_string();
+}
+
+bool IsAnyChanged(const std::vector<std::string>& aDependencies, const std::set<std::string>& aChanged)
+{
+	return std::ranges::any_of(aDependencies, [&aChanged](const std::string& aDependency) { return aChanged.contains(aDependency); });
+}
@@ -3,9 +3,16 @@
 #define TOOLS_FILEHELEPERS_H
 
 #include <vector>
+#include <set>
 #include <string>
 #include <filesystem>
 
 std::vector<std::string> ReadWholeFile(const std::filesystem::path& aFilePath);
 
+// The spelling of a path that is the same however an existing file was reached, what files are compared by
+std::string FileKey(const std::filesystem::path& aFile);
+
+// Whether any of the files a file depends on is among the changed ones, all of them spelled by FileKey
+bool IsAnyChanged(const std::vector<std::string>& aDependencies, const std::set<std::string>& aChanged);
+
 #endif
\ No newline at end of file